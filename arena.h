@@ -0,0 +1,64 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "memory_stats.h"
+
+// bump allocator for memory that only lives while a job runs
+// a job takes what it needs from its thread's arena and the worker resets it once the job is done
+typedef struct {
+    unsigned char* base;
+    size_t size;
+    size_t used;
+    size_t high_water; // most bytes ever in use at once
+} Arena;
+
+#define ARENA_ALIGN 16
+// scratch needed by the largest job, meshing a chunk with its padded neighbor copy
+#define SCRATCH_SIZE (1 << 18)
+
+Arena new_Arena(size_t size) {
+    return (Arena){
+        .base = mem_malloc(MEM_JOBS, size),
+        .size = size,
+    };
+}
+
+void free_Arena(Arena* arena) {
+    mem_free(MEM_JOBS, arena->base, arena->size);
+    *arena = (Arena){0};
+}
+
+// memory isn't cleared, running out means SCRATCH_SIZE is too small for a job so there's no fallback
+void* arena_alloc(Arena* arena, size_t bytes) {
+    size_t start = (arena->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (!arena->base || start + bytes > arena->size) {
+        fprintf(stderr, "Failed to allocate %zu bytes from a %zu byte arena\n", bytes, arena->size);
+        abort();
+    }
+    arena->used = start + bytes;
+    if (arena->used > arena->high_water) arena->high_water = arena->used;
+    return arena->base + start;
+}
+
+// functions using scratch save arena->used on entry and rewind to it before returning
+void arena_rewind(Arena* arena, size_t mark) {
+    arena->used = mark;
+}
+
+void arena_reset(Arena* arena) {
+    arena->used = 0;
+}
+
+// every thread has its own scratch arena so workers never share an allocator or a lock
+// it's allocated the first time a thread asks for it, the thread frees it before exiting
+_Thread_local Arena Scratch;
+
+Arena* scratch_arena() {
+    if (!Scratch.base) Scratch = new_Arena(SCRATCH_SIZE);
+    return &Scratch;
+}
+
+void free_scratch_arena() {
+    if (Scratch.base) free_Arena(&Scratch);
+}
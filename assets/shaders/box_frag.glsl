@@ -0,0 +1,7 @@
+#version 330 core
+out vec4 FragColor;
+
+// only the samples passed count matters, color writes are masked off
+void main() {
+    FragColor = vec4(1.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec3 aPos; // unit cube corner
+
+// shared by every program, see CameraBlock
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewproj;
+    vec4 frustumPlanes[6];
+    vec4 cameraPos;
+};
+
+uniform vec3 boxMin;
+uniform vec3 boxSize;
+
+void main() {
+    gl_Position = viewproj * vec4(boxMin + aPos * boxSize, 1.0);
+}
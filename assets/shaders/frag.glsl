@@ -1,6 +1,7 @@
 #version 330 core
 in vec2 TexCoord;
-flat in int isSolidColor;
+in float Light;
+flat in vec4 Tile;
 
 
 out vec4 FragColor;
@@ -10,10 +11,18 @@ uniform vec2 screenSize;  // Pass viewport size from your app
 
 
 void main() {
-    vec4 color = vec4(0.0, 0.56, 0.78, 1.0);
-    if(isSolidColor == 0){
-        color = texture(texture1, TexCoord);
-    }
+#ifdef DEPTH_ONLY
+    // depth pre-pass, color writes are masked off
+    FragColor = vec4(0.0);
+    return;
+#endif
+    // merged faces span several blocks, the texture repeats inside its atlas tile
+    vec4 color = texture(texture1, Tile.xy + fract(TexCoord) * Tile.zw);
+#ifdef ALPHA_TEST
+    // only the cutout variant discards, the opaque pass keeps early depth testing
+    if (color.a < 0.5) discard;
+#endif
+    color.rgb *= Light;
     
     // Define crosshair size in pixels
     float crosshairHalfSize = 13.0;
@@ -0,0 +1,36 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;      // corner of a unit cube centered on the origin
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in float aFace;    // Face the corner belongs to
+// per instance, see BlockInstance
+layout (location = 3) in vec4 iPositionScale; // center and edge length
+layout (location = 4) in vec2 iYawLight;      // rotation around y in radians and brightness
+layout (location = 5) in uint iBlock;
+
+// shared by every program, see CameraBlock
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewproj;
+    vec4 frustumPlanes[6];
+    vec4 cameraPos;
+};
+
+uniform vec4 tiles[64];              // atlas rectangle of each texture, as in vert.glsl
+uniform usamplerBuffer faceTextures; // texture of each block's faces, 6 per block in Face order
+
+// frag.glsl takes these from the geometry shader in the chunk programs
+out vec2 TexCoord;
+out float Light;
+flat out vec4 Tile;
+
+void main() {
+    float c = cos(iYawLight.x);
+    float s = sin(iYawLight.x);
+    vec3 corner = aPos * iPositionScale.w;
+    corner = vec3(c * corner.x - s * corner.z, corner.y, s * corner.x + c * corner.z);
+    gl_Position = viewproj * vec4(iPositionScale.xyz + corner, 1.0);
+    TexCoord = aTexCoord;
+    Light = iYawLight.y;
+    Tile = tiles[texelFetch(faceTextures, int(iBlock) * 6 + int(aFace)).r];
+}
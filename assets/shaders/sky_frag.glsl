@@ -0,0 +1,23 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform vec2 screenSize;
+
+// sky color wherever no face was drawn, frag.glsl draws the crosshair over everything else
+void main() {
+    vec4 color = vec4(0.0, 0.56, 0.78, 1.0);
+
+    float crosshairHalfSize = 13.0;
+    float crosshairWidth = 2;
+
+    vec2 center = screenSize * 0.5;
+
+    bool inHorizontal = abs(gl_FragCoord.y - center.y) < crosshairWidth && abs(gl_FragCoord.x - center.x) < crosshairHalfSize;
+    bool inVertical = abs(gl_FragCoord.x - center.x) < crosshairWidth && abs(gl_FragCoord.y - center.y) < crosshairHalfSize;
+
+    if (inHorizontal || inVertical) {
+        color.rgb = vec3(1.0) - color.rgb;  // invert colors
+    }
+
+    FragColor = color;
+}
@@ -0,0 +1,7 @@
+#version 330 core
+
+// full screen triangle just in front of the far plane, made from gl_VertexID so it needs no vertex buffer
+void main() {
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.999999, 1.0);
+}
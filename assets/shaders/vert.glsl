@@ -1,15 +1,31 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+// shared by every program, see CameraBlock
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewproj;
+    vec4 frustumPlanes[6];
+    vec4 cameraPos;
+};
 layout(location = 1) in vec2 aTexCoord;  // Add this for UVs
+layout(location = 2) in float aLight;    // brightness from the light engine
+layout(location = 3) in float aTile;     // texture in the atlas, aTexCoord repeats it once per unit
+
+uniform vec4 tiles[64]; // atlas rectangle of each texture, xy origin and zw size
 
 out vec2 inTexCoord;  // Pass to fragment shader
+out float inLight;
+flat out vec4 inTile;
+// the depth pre-pass and the color pass are separate programs, their depths have to match exactly for GL_EQUAL
+invariant gl_Position;
 
 
 void main() {
-    gl_Position = projection * view * vec4(aPos, 1.0);
+    gl_Position = viewproj * vec4(aPos, 1.0);
     inTexCoord = aTexCoord;
+    inLight = aLight;
+    inTile = tiles[int(aTile)];
 }
 
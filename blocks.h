@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t BlockId;
+
+// ids the engine uses directly, assets/block_table.txt has to register them under these ids
+enum {
+    BLOCK_AIR = 0,
+    BLOCK_GRASS,
+    BLOCK_DIRT,
+    BLOCK_COBBLED_STONE,
+    BLOCK_LAMP,
+    BLOCK_GLASS,
+    BLOCK_WATER,
+    BLOCK_ID_COUNT,
+};
+
+#define MAX_BLOCKS 256
+#define BLOCK_NAME_SIZE 32
+#define NO_TEXTURE 0xff
+
+// pass a block's faces are drawn in, cutout textures are alpha tested and translucent ones blended back to front
+typedef enum {
+    RENDER_LAYER_NONE,
+    RENDER_LAYER_OPAQUE,
+    RENDER_LAYER_CUTOUT,
+    RENDER_LAYER_TRANSLUCENT,
+} RenderLayer;
+
+// block properties indexed by id, one table per property so a lookup is a single array index
+// ids that aren't registered are all zero, invisible and non solid like air
+typedef struct {
+    size_t count; // highest registered id + 1
+    char names[MAX_BLOCKS][BLOCK_NAME_SIZE];
+    uint8_t face_textures[MAX_BLOCKS][6]; // atlas texture of each face in Face order
+    bool opaque[MAX_BLOCKS];              // hides the faces of neighbors and stops light
+    bool solid[MAX_BLOCKS];               // bodies collide with it
+    uint8_t render_layer[MAX_BLOCKS];     // RenderLayer
+    uint8_t emission[MAX_BLOCKS];         // block light it gives off, 0..15
+} BlockRegistry;
+
+BlockRegistry Blocks;
+
+int find_name(const char* name, const char* const* names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+// parses the block table in assets/block_table.txt, texture names are looked up in textures
+// one block per line: id name top bottom side opaque solid layer emission, # starts a comment
+bool load_blocks(BlockRegistry* registry, const char* text, const char* const* textures, int texture_count) {
+    static const char* const LAYERS[] = { "none", "opaque", "cutout", "translucent" };
+    memset(registry, 0, sizeof(*registry));
+    int line_number = 0;
+    while (*text) {
+        const char* end = strchr(text, '\n');
+        size_t len = end ? (size_t)(end - text) : strlen(text);
+        char line[256];
+        if (len >= sizeof(line)) len = sizeof(line) - 1;
+        memcpy(line, text, len);
+        line[len] = '\0';
+        text += end ? len + 1 : len;
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        int id, opaque, solid, emission;
+        char name[BLOCK_NAME_SIZE], top[BLOCK_NAME_SIZE], bottom[BLOCK_NAME_SIZE], side[BLOCK_NAME_SIZE], layer[BLOCK_NAME_SIZE];
+        int fields = sscanf(line, "%d %31s %31s %31s %31s %d %d %31s %d", &id, name, top, bottom, side, &opaque, &solid, layer, &emission);
+        if (fields <= 0) continue; // blank line
+        if (fields != 9) {
+            fprintf(stderr, "block_table.txt:%d: expected 9 fields, got %d\n", line_number, fields);
+            return false;
+        }
+        if (id < 0 || id >= MAX_BLOCKS || registry->names[id][0]) {
+            fprintf(stderr, "block_table.txt:%d: bad or duplicate id %d\n", line_number, id);
+            return false;
+        }
+        const char* face_names[3] = { top, bottom, side };
+        int face_textures[3];
+        for (int i = 0; i < 3; i++) {
+            face_textures[i] = strcmp(face_names[i], "-") == 0 ? NO_TEXTURE : find_name(face_names[i], textures, texture_count);
+            if (face_textures[i] < 0) {
+                fprintf(stderr, "block_table.txt:%d: unknown texture %s\n", line_number, face_names[i]);
+                return false;
+            }
+        }
+        int render_layer = find_name(layer, LAYERS, 4);
+        if (render_layer < 0 || emission < 0 || emission > 15) {
+            fprintf(stderr, "block_table.txt:%d: bad render layer or emission\n", line_number);
+            return false;
+        }
+        // drawn faces look their texture up in the atlas, only invisible blocks can go without
+        for (int i = 0; i < 3 && render_layer != RENDER_LAYER_NONE; i++) {
+            if (face_textures[i] == NO_TEXTURE) {
+                fprintf(stderr, "block_table.txt:%d: %s is drawn but has no %s texture\n", line_number, name,
+                    i == 0 ? "top" : i == 1 ? "bottom" : "side");
+                return false;
+            }
+        }
+        strcpy(registry->names[id], name);
+        for (int face = 0; face < 6; face++) {
+            // Face order is +x -x +y -y +z -z
+            registry->face_textures[id][face] = face == 2 ? face_textures[0] : face == 3 ? face_textures[1] : face_textures[2];
+        }
+        registry->opaque[id] = opaque;
+        registry->solid[id] = solid;
+        registry->render_layer[id] = render_layer;
+        registry->emission[id] = emission;
+        if ((size_t)id >= registry->count) registry->count = id + 1;
+    }
+    for (int id = 0; id < BLOCK_ID_COUNT; id++) {
+        if (!registry->names[id][0]) {
+            fprintf(stderr, "block_table.txt: block %d is used by the engine but not registered\n", id);
+            return false;
+        }
+    }
+    return true;
+}
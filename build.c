@@ -38,70 +38,83 @@
 
 
 
-void compile_cmake(string name, string winsln) {
+bool compile_cmake(string name, string winsln) {
     char build_dir[BufferSize] = {'\0'};
-    sprintf(build_dir, "./deps/%s/build/", name);
-    if(!Build.fs.exists(build_dir)) {
-        Build.fs.mkdir(build_dir);
-        char cmd[BufferSize] ={'\0'};
-        sprintf(cmd, "cmake -S ./deps/%s -B ./deps/%s/build/ -DCGLM_SHARED=OFF -DCGLM_STATIC=ON", name, name);
-        system(cmd);
-        cmd[0] = '\0';
-        sprintf(cmd, "cmake --build ./deps/%s/build/", name);
-        system(cmd);
-#ifdef _WIN32
-        cmd[0] = '\0';
-        sprintf(cmd, "msbuild /deps/%s/build/%s.sln p:Configuration=Release", name, winsln);
-        system(cmd);
-#endif
-    } else {
+    snprintf(build_dir, sizeof(build_dir), "./deps/%s/build/", name);
+    if(Build.fs.exists(build_dir)) {
         printf("not rebuilding %s\n", name);
+        return true;
     }
-}
-
-void compile_asset(string in, string out) {
-    char cmd [BufferSize] = {'\0'};
-    if(__Build_needs_rebuild__(out, StringArray(in), 1)) {
-        sprintf(cmd, "xxd -i %s > %s", in, out);
-        printf("running %s\n", cmd);
-        system(cmd);
-        printf("done\n");
-    } else {
-        printf("not rebuilding %s\n", out);
+    Build.fs.mkdir(build_dir);
+    Cmd cmd = {0};
+    Build.cmd.append(&cmd, "cmake");
+    Build.cmd.appendf(&cmd, "-S./deps/%s", name);
+    Build.cmd.appendf(&cmd, "-B./deps/%s/build/", name);
+    Build.cmd.append(&cmd, "-DCGLM_SHARED=OFF");
+    Build.cmd.append(&cmd, "-DCGLM_STATIC=ON");
+    Build.cmd.append(&cmd, "-DCMAKE_BUILD_TYPE=Release");
+    int status = Build.cmd.run(&cmd);
+    if(status == 0) {
+        Build.cmd.reset(&cmd);
+        Build.cmd.append(&cmd, "cmake");
+        Build.cmd.append(&cmd, "--build");
+        Build.cmd.appendf(&cmd, "./deps/%s/build/", name);
+        status = Build.cmd.run(&cmd);
+    }
+#ifdef _WIN32
+    if(status == 0) {
+        Build.cmd.reset(&cmd);
+        Build.cmd.append(&cmd, "msbuild");
+        Build.cmd.appendf(&cmd, "/deps/%s/build/%s.sln", name, winsln);
+        Build.cmd.append(&cmd, "p:Configuration=Release");
+        status = Build.cmd.run(&cmd);
+    }
+#endif
+    Build.cmd.free(&cmd);
+    if(status != 0) {
+        fprintf(stderr, "\033[31mbuilding %s failed (exit code %d)\033[0m\n", name, status);
+        return false;
     }
+    return true;
 }
 
-void make_assets() {
+bool make_assets() {
     if(!Build.fs.exists("./target/assets")) {
         Build.fs.mkdir("./target/assets");
     }
     if(!Build.fs.exists("./target/assets/shaders")) {
         Build.fs.mkdir("./target/assets/shaders");
     }
-    compile_asset("./assets/shaders/frag.glsl", "./target/assets/shaders/frag.h");
-    compile_asset("./assets/shaders/vert.glsl", "./target/assets/shaders/vert.h");
-    compile_asset("./assets/shaders/geo.glsl", "./target/assets/shaders/geo.h");
+    if(!Build.embed("./assets/shaders/frag.glsl", "./target/assets/shaders/frag")) return false;
+    if(!Build.embed("./assets/shaders/vert.glsl", "./target/assets/shaders/vert")) return false;
+    if(!Build.embed("./assets/shaders/geo.glsl", "./target/assets/shaders/geo")) return false;
+    if(!Build.embed("./assets/shaders/box_vert.glsl", "./target/assets/shaders/box_vert")) return false;
+    if(!Build.embed("./assets/shaders/box_frag.glsl", "./target/assets/shaders/box_frag")) return false;
+    if(!Build.embed("./assets/shaders/instance_vert.glsl", "./target/assets/shaders/instance_vert")) return false;
+    if(!Build.embed("./assets/shaders/sky_vert.glsl", "./target/assets/shaders/sky_vert")) return false;
+    if(!Build.embed("./assets/shaders/sky_frag.glsl", "./target/assets/shaders/sky_frag")) return false;
+    if(!Build.embed("./assets/block_table.txt", "./target/assets/block_table")) return false;
     if(!Build.fs.exists("./target/assets/textures")) {
         Build.fs.mkdir("./target/assets/textures");
     }
-    compile_asset("./assets/textures/cobbled_stone.png", "./target/assets/textures/cobbled_stone.h");
-    compile_asset("./assets/textures/grass.png", "./target/assets/textures/grass.h");
-    compile_asset("./assets/textures/dirt.png", "./target/assets/textures/dirt.h");
-    compile_asset("./assets/textures/grass_side.png", "./target/assets/textures/grass_side.h");
+    if(!Build.embed("./assets/textures/cobbled_stone.png", "./target/assets/textures/cobbled_stone")) return false;
+    if(!Build.embed("./assets/textures/grass.png", "./target/assets/textures/grass")) return false;
+    if(!Build.embed("./assets/textures/dirt.png", "./target/assets/textures/dirt")) return false;
+    if(!Build.embed("./assets/textures/grass_side.png", "./target/assets/textures/grass_side")) return false;
+    if(!Build.embed("./assets/textures/lamp.png", "./target/assets/textures/lamp")) return false;
+    if(!Build.embed("./assets/textures/glass.png", "./target/assets/textures/glass")) return false;
+    if(!Build.embed("./assets/textures/water.png", "./target/assets/textures/water")) return false;
+    return true;
 }
 
-int main() {
-    if(!Build.fs.exists("./target")) {
-        Build.fs.mkdir("./target");
-    }
-    make_assets();
-    Build.fetch_git("https://github.com/glfw/glfw.git", false);
-    compile_cmake("glfw", "GLFW");
-    Build.fetch_git("https://github.com/recp/cglm.git", false);
-    compile_cmake("cglm", "cglm");
-    Build.fetch_git("https://github.com/nothings/stb.git", false);
-    Build.build(
-            OBJECT("./target/glad"), 
+bool build_engine(Profile* profile) {
+    char glad[BufferSize], main_obj[BufferSize], exe[BufferSize];
+    snprintf(glad, sizeof(glad), "%s" OBJECT("glad"), profile->dir);
+    snprintf(main_obj, sizeof(main_obj), "%s" OBJECT("main"), profile->dir);
+    snprintf(exe, sizeof(exe), "%s" EXECUTABLE("main"), profile->dir);
+    if(!Build.profile.build(
+            profile,
+            glad, 
             StringArray("./glad/src/gl.c"), 
             1, 
             FlagArray(
@@ -109,20 +122,44 @@ int main() {
                 FLAG_INCLUDE_PATH("./glad/include/")
             ),
             2
-            );
-    Build.build(
-            OBJECT("./target/main"), 
+            )) return false;
+    if(!Build.profile.build(
+            profile,
+            main_obj, 
             StringArray(
                 "./main.c", 
+                "./world.h",
+                "./blocks.h",
+                "./raycast.h",
+                "./physics.h",
+                "./culling.h",
+                "./light.h",
+                "./memory_stats.h",
+                "./arena.h",
+                "./pool.h",
+                "./compress.h",
+                "./jobs.h",
+                "./startup.h",
+                "./pacing.h",
+                "./debris.h",
                 "./target/assets/shaders/frag.h", 
                 "./target/assets/shaders/vert.h", 
                 "./target/assets/shaders/geo.h",
+                "./target/assets/shaders/box_vert.h",
+                "./target/assets/shaders/box_frag.h",
+                "./target/assets/shaders/instance_vert.h",
+                "./target/assets/shaders/sky_vert.h",
+                "./target/assets/shaders/sky_frag.h",
                 "./target/assets/textures/cobbled_stone.h",
                 "./target/assets/textures/grass.h", 
                 "./target/assets/textures/dirt.h",
-                "./target/assets/textures/grass_side.h"
+                "./target/assets/textures/grass_side.h",
+                "./target/assets/textures/lamp.h",
+                "./target/assets/textures/glass.h",
+                "./target/assets/textures/water.h",
+                "./target/assets/block_table.h"
                 ), 
-            8, 
+            31, 
             FlagArray(
                 FLAG_COMPILE_ONLY, 
                 FLAG_INCLUDE_PATH("./deps/glfw/include/"), 
@@ -131,13 +168,94 @@ int main() {
                 FLAG_INCLUDE_PATH("./deps/cglm/include/"),
                 FLAG_INCLUDE_PATH("./deps/stb"),
                 ),
-            6);
-    Build.build(
-            EXECUTABLE("./main"),
-            StringArray(OBJECT("./target/main"), "./deps/glfw/build/src/libglfw3"LIB, OBJECT("./target/glad"), "./deps/cglm/build/libcglm"LIB),
-            4,
+            6)) return false;
+    if(!Build.profile.build(
+            profile,
+            exe,
+            StringArray(
+                main_obj,
+                "./deps/glfw/build/src/libglfw3"LIB,
+                glad,
+                "./deps/cglm/build/libcglm"LIB,
+                OBJECT("./target/assets/shaders/frag"),
+                OBJECT("./target/assets/shaders/vert"),
+                OBJECT("./target/assets/shaders/geo"),
+                OBJECT("./target/assets/shaders/box_vert"),
+                OBJECT("./target/assets/shaders/box_frag"),
+                OBJECT("./target/assets/shaders/instance_vert"),
+                OBJECT("./target/assets/shaders/sky_vert"),
+                OBJECT("./target/assets/shaders/sky_frag"),
+                OBJECT("./target/assets/textures/cobbled_stone"),
+                OBJECT("./target/assets/textures/grass"),
+                OBJECT("./target/assets/textures/dirt"),
+                OBJECT("./target/assets/textures/grass_side"),
+                OBJECT("./target/assets/textures/lamp"),
+                OBJECT("./target/assets/textures/glass"),
+                OBJECT("./target/assets/textures/water"),
+                OBJECT("./target/assets/block_table")
+                ),
+            20,
             PLATFORM_LIBS
-            );
-    return 0;
+            )) return false;
+    printf("built %s\n", exe);
+    return true;
 }
 
+// outputs of the other pgo phase would otherwise look up to date
+void clean_engine(Profile* profile) {
+    char path[BufferSize];
+    snprintf(path, sizeof(path), "%s" OBJECT("glad"), profile->dir);
+    Build.fs.remove(path);
+    snprintf(path, sizeof(path), "%s" OBJECT("main"), profile->dir);
+    Build.fs.remove(path);
+    snprintf(path, sizeof(path), "%s" EXECUTABLE("main"), profile->dir);
+    Build.fs.remove(path);
+}
+
+// instrumented build, training run on the headless benchmark scene, then the optimized build
+bool build_pgo() {
+    Profile generate = PROFILE_PGO_GENERATE;
+    Profile use = PROFILE_PGO_USE;
+    clean_engine(&generate);
+    Build.profile.clean_data(&generate);
+    if(!build_engine(&generate)) return false;
+
+    char exe[BufferSize];
+    snprintf(exe, sizeof(exe), "%s" EXECUTABLE("main"), generate.dir);
+    Cmd cmd = {0};
+    Build.cmd.append(&cmd, exe);
+    Build.cmd.append(&cmd, "--bench");
+    int status = Build.cmd.run(&cmd);
+    Build.cmd.free(&cmd);
+    if(status != 0) {
+        fprintf(stderr, "\033[31mpgo training run failed (exit code %d)\033[0m\n", status);
+        return false;
+    }
+    if(!Build.profile.merge_data(&generate)) return false;
+
+    clean_engine(&use);
+    return build_engine(&use);
+}
+
+// ./build [debug|release|lto|pgo]
+int main() {
+    string profile_name = argc > 1 ? argv[1] : "debug";
+    Profile profile;
+    if(!Build.profile.find(profile_name, &profile)) {
+        fprintf(stderr, "\033[31munknown profile %s, expected debug, release, lto or pgo\033[0m\n", profile_name);
+        return 1;
+    }
+    if(!Build.fs.exists("./target")) {
+        Build.fs.mkdir("./target");
+    }
+    if(!make_assets()) return 1;
+    if(!Build.fetch_git("https://github.com/glfw/glfw.git", false)) return 1;
+    if(!compile_cmake("glfw", "GLFW")) return 1;
+    if(!Build.fetch_git("https://github.com/recp/cglm.git", false)) return 1;
+    if(!compile_cmake("cglm", "cglm")) return 1;
+    if(!Build.fetch_git("https://github.com/nothings/stb.git", false)) return 1;
+    if(strcmp(profile.name, "pgo") == 0) {
+        return build_pgo() ? 0 : 1;
+    }
+    return build_engine(&profile) ? 0 : 1;
+}
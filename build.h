@@ -9,16 +9,25 @@
 #include <string.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdarg.h>
 
 #ifdef _WIN32
 #include <windows.h>
 #include <process.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #define _OBJ ".obj"
 #define _EXE ".exe"
 #define ROOT "C:/"
 #else
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <dirent.h>
 #define _OBJ ".o"
 #define _EXE ""
 #define ROOT "/"
@@ -42,6 +51,9 @@ typedef enum {
     __FLAG_DEFINE_MACRO,
     __FLAG_COMPILE_ONLY,
     __FLAG_LANGUAGE_STANDARD,
+    __FLAG_LTO,
+    __FLAG_PGO_GENERATE,
+    __FLAG_PGO_USE,
     __FLAG_RAW,//not cross platform
 } FlagType;
 
@@ -51,11 +63,15 @@ typedef enum {
 #define FLAG_WARNINGS_LEVEL_3 (Flag){ .type = __FLAG_WARNINGS_LEVEL_3 }
 #define FLAG_WARNINGS_LEVEL_4 (Flag){ .type = __FLAG_WARNINGS_LEVEL_4 }
 #define FLAG_COMPILE_ONLY  (Flag){ .type = __FLAG_COMPILE_ONLY }
+#define FLAG_LTO (Flag){ .type = __FLAG_LTO }
 
 #define FLAG_RAW(raw_flag) (Flag){.type=__FLAG_RAW, .str_value=raw_flag}
 #define FLAG_INCLUDE_PATH(path) (Flag){ .type = __FLAG_INCLUDE_PATH, .str_value = path }
 #define FLAG_DEFINE_MACRO(macro) (Flag){ .type = __FLAG_DEFINE_MACRO, .str_value = macro }
 #define FLAG_LANGUAGE_STANDARD(std) (Flag){ .type = __FLAG_LANGUAGE_STANDARD, .str_value = std }
+// dir is where the profile data lives, has to be the directory the objects are written to
+#define FLAG_PGO_GENERATE(dir) (Flag){ .type = __FLAG_PGO_GENERATE, .str_value = dir }
+#define FLAG_PGO_USE(dir) (Flag){ .type = __FLAG_PGO_USE, .str_value = dir }
 
 #define MAX_FLAG_STRINGS 4 // one flag can expand to multiple strings
 
@@ -72,9 +88,43 @@ typedef struct {
 #define StringArray(...) ((string[]) {__VA_ARGS__})
 #define FlagArray(...) ((Flag[]) {__VA_ARGS__})
 
+#define MAX_PROFILE_FLAGS 8
+
+// a named set of flags added to every compile and link, outputs go to dir so profiles never share objects
+typedef struct {
+    string name;
+    string dir;
+    Flag flags[MAX_PROFILE_FLAGS];
+    size_t flag_count;
+} Profile;
+
+#define PROFILE_DEBUG (Profile){ \
+    .name = "debug", .dir = "./target/debug/", \
+    .flags = { FLAG_DEBUG }, .flag_count = 1 }
+#define PROFILE_RELEASE (Profile){ \
+    .name = "release", .dir = "./target/release/", \
+    .flags = { FLAG_OPTIMIZE_SPEED, FLAG_DEFINE_MACRO("NDEBUG") }, .flag_count = 2 }
+#define PROFILE_RELEASE_LTO (Profile){ \
+    .name = "lto", .dir = "./target/lto/", \
+    .flags = { FLAG_OPTIMIZE_SPEED, FLAG_DEFINE_MACRO("NDEBUG"), FLAG_LTO }, .flag_count = 3 }
+// the two pgo phases share a directory, gcc looks the profile data up by object path
+#define PROFILE_PGO_GENERATE (Profile){ \
+    .name = "pgo-generate", .dir = "./target/pgo/", \
+    .flags = { FLAG_OPTIMIZE_SPEED, FLAG_DEFINE_MACRO("NDEBUG"), FLAG_LTO, FLAG_PGO_GENERATE("./target/pgo/") }, .flag_count = 4 }
+#define PROFILE_PGO_USE (Profile){ \
+    .name = "pgo", .dir = "./target/pgo/", \
+    .flags = { FLAG_OPTIMIZE_SPEED, FLAG_DEFINE_MACRO("NDEBUG"), FLAG_LTO, FLAG_PGO_USE("./target/pgo/") }, .flag_count = 4 }
+
+// argv vector for a child process, every arg is owned by the Cmd
+typedef struct {
+    char** data;
+    size_t count;
+    size_t capacity;
+} Cmd;
+
 
 EXTERN struct {
-    void (*build)(string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length);
+    bool (*build)(string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length);
     bool (*str_ends_with)(string str, string suffix);
     struct {
         bool (*exists)(string path);
@@ -85,13 +135,115 @@ EXTERN struct {
         void (*mkdir)(string path);
         void (*remove)(string path);
     } fs;
-    void (*fetch_git)(string url, bool build); //build does nothing at the moment
+    struct {
+        void (*append)(Cmd* cmd, string arg);
+        void (*appendf)(Cmd* cmd, string fmt, ...);
+        int (*run)(Cmd* cmd); // exit code of the child, -1 if it could not be started
+        int (*run_redirect)(Cmd* cmd, string stdout_path); // same as run, with stdout written to stdout_path
+        void (*reset)(Cmd* cmd);
+        void (*free)(Cmd* cmd);
+    } cmd;
+    struct {
+        bool (*find)(string name, Profile* out); // looks up one of the builtin profiles by name
+        bool (*build)(Profile* profile, string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length);
+        bool (*merge_data)(Profile* profile); // turns raw pgo counters into something the compiler reads, after the training run
+        void (*clean_data)(Profile* profile); // removes pgo counters from older runs
+    } profile;
+    // embeds the bytes of file into out.o through an .incbin stub (out.s), out.h declares
+    // <symbol>_start, <symbol>_end and <symbol>_len, symbol is the file path with every
+    // non alphanumeric char replaced by _, the data is followed by a '\0' not counted in len
+    bool (*embed)(string file, string out);
+    bool (*fetch_git)(string url, bool build); //build does nothing at the moment
 } Build;
 
 // implementation
 #ifdef BUILD_IMPLEMENTATION
 
+char* __Build_strdup__(string str) {
+    size_t len = strlen(str);
+    char* new = malloc(len + 1);
+    memcpy(new, str, len + 1);
+    return new;
+}
+
+void __BUILD__CMD_reserve(Cmd* cmd, size_t capacity) {
+    if(cmd->capacity >= capacity) return;
+    size_t new_capacity = cmd->capacity ? cmd->capacity : 16;
+    while(new_capacity < capacity) new_capacity *= 2;
+    cmd->data = realloc(cmd->data, sizeof(char*) * new_capacity);
+    cmd->capacity = new_capacity;
+}
+
+void __BUILD__CMD_append(Cmd* cmd, string arg) {
+    __BUILD__CMD_reserve(cmd, cmd->count + 2); // keep room for the NULL terminator
+    cmd->data[cmd->count++] = __Build_strdup__(arg);
+}
+
+void __BUILD__CMD_appendf(Cmd* cmd, string fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    char* arg = malloc(len + 1);
+    va_start(args, fmt);
+    vsnprintf(arg, len + 1, fmt, args);
+    va_end(args);
+    __BUILD__CMD_reserve(cmd, cmd->count + 2);
+    cmd->data[cmd->count++] = arg;
+}
+
+void __BUILD__CMD_reset(Cmd* cmd) {
+    for(size_t i = 0; i < cmd->count; i++) {
+        free(cmd->data[i]);
+    }
+    cmd->count = 0;
+}
+
+void __BUILD__CMD_free(Cmd* cmd) {
+    __BUILD__CMD_reset(cmd);
+    free(cmd->data);
+    cmd->data = NULL;
+    cmd->capacity = 0;
+}
+
+void __BUILD__CMD_print(Cmd* cmd) {
+    printf("running cmd");
+    for(size_t i = 0; i < cmd->count; i++) {
+        printf(" %s", cmd->data[i]);
+    }
+    printf("\n");
+}
+
 #ifdef _WIN32
+int __BUILD__CMD_run_redirect(Cmd* cmd, string stdout_path) {
+    if(cmd->count == 0) return -1;
+    __BUILD__CMD_print(cmd);
+    __BUILD__CMD_reserve(cmd, cmd->count + 1);
+    cmd->data[cmd->count] = NULL;
+    int saved_stdout = -1;
+    if(stdout_path) {
+        int fd = _open(stdout_path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+        if(fd < 0) {
+            fprintf(stderr, "\033[31mcould not open %s\033[0m\n", stdout_path);
+            return -1;
+        }
+        fflush(stdout);
+        saved_stdout = _dup(1);
+        _dup2(fd, 1);
+        _close(fd);
+    }
+    intptr_t status = _spawnvp(_P_WAIT, cmd->data[0], (const char* const*)cmd->data);
+    if(stdout_path) {
+        fflush(stdout);
+        _dup2(saved_stdout, 1);
+        _close(saved_stdout);
+    }
+    if(status == -1) {
+        fprintf(stderr, "\033[31mfailed to start %s\033[0m\n", cmd->data[0]);
+        return -1;
+    }
+    return (int)status;
+}
 void __Build_Switch_New__() {
     system("start \"\" /B cmd /C \"timeout /t 1 >nul && move /Y build.new.exe build.exe && build.exe\"");
     exit(0);
@@ -152,6 +304,43 @@ void __BUILD__FS_remove(string path) {
     }
 }
 #else
+extern char** environ;
+
+int __BUILD__CMD_run_redirect(Cmd* cmd, string stdout_path) {
+    if(cmd->count == 0) return -1;
+    __BUILD__CMD_print(cmd);
+    __BUILD__CMD_reserve(cmd, cmd->count + 1);
+    cmd->data[cmd->count] = NULL;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if(stdout_path) {
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, stdout_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    fflush(stdout);
+    pid_t pid;
+    int err = posix_spawnp(&pid, cmd->data[0], &actions, NULL, cmd->data, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if(err != 0) {
+        fprintf(stderr, "\033[31mfailed to start %s: %s\033[0m\n", cmd->data[0], strerror(err));
+        return -1;
+    }
+
+    int status;
+    while(waitpid(pid, &status, 0) < 0) {
+        if(errno != EINTR) {
+            perror("waitpid failed");
+            return -1;
+        }
+    }
+    if(WIFEXITED(status)) return WEXITSTATUS(status);
+    if(WIFSIGNALED(status)) {
+        fprintf(stderr, "\033[31m%s killed by signal %d\033[0m\n", cmd->data[0], WTERMSIG(status));
+        return 128 + WTERMSIG(status);
+    }
+    return -1;
+}
+
 bool __BUILD__FS_exists(string file) {
     struct stat st;
     return stat(file, &st) == 0;
@@ -165,9 +354,12 @@ bool __BUILD__FS_is_dir(string path) {
     return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
 }
 void __BUILD__FS_copy(string from, string to) {
-    char cmd[BufferSize];
-    snprintf(cmd, sizeof(cmd), "cp \"%s\" \"%s\"", from, to);
-    system(cmd);
+    Cmd cmd = {0};
+    __BUILD__CMD_append(&cmd, "cp");
+    __BUILD__CMD_append(&cmd, from);
+    __BUILD__CMD_append(&cmd, to);
+    __BUILD__CMD_run_redirect(&cmd, NULL);
+    __BUILD__CMD_free(&cmd);
 }
 void __BUILD__FS_fs_move(string from, string to) {
     rename(from, to);
@@ -181,6 +373,7 @@ void __BUILD__FS_remove(string path) {
 
 void __Build_Switch_New__() {
     sleep(1);
+    fflush(stdout);
     rename("./build.new", "./build");
     char *new_argv[] = {"./build", NULL};
     execvp(new_argv[0], new_argv);
@@ -199,6 +392,10 @@ bool __Build_needs_rebuild__(string output, string sources[], size_t n) {
 }
 #endif
 
+int __BUILD__CMD_run(Cmd* cmd) {
+    return __BUILD__CMD_run_redirect(cmd, NULL);
+}
+
 bool __Build_Ends_With__(string str, string suffix) {
     if (!str || !suffix)
         return false;
@@ -218,7 +415,9 @@ void __Build_Bootstrap__() {
         "./build.h",
     };
     if(__Build_needs_rebuild__(EXECUTABLE("./build"), deps, 2)) {
-        Build.build(EXECUTABLE("./build.new"), deps, 2, (Flag[]) {}, 0); 
+        if(!Build.build(EXECUTABLE("./build.new"), deps, 2, (Flag[]) {}, 0)) {
+            exit(1);
+        }
         __Build_Switch_New__();
     } else {
         printf("not rebuilding build\n");
@@ -269,6 +468,42 @@ FlagStringList flag_to_strings(Flag flag) {
             result.data[1] = flag.str_value; // e.g., "c99", "gnu11"
             result.count = 2;
             break;
+#ifdef __clang__
+        case __FLAG_LTO:
+            result.data[0] = "-flto=thin";
+            result.count = 1;
+            break;
+        case __FLAG_PGO_GENERATE: {
+            static char generate[BufferSize];
+            snprintf(generate, sizeof(generate), "-fprofile-generate=%s", flag.str_value);
+            result.data[0] = generate;
+            result.count = 1;
+            break;
+        }
+        case __FLAG_PGO_USE: {
+            static char use[BufferSize];
+            snprintf(use, sizeof(use), "-fprofile-use=%sdefault.profdata", flag.str_value);
+            result.data[0] = use;
+            result.data[1] = "-Wno-profile-instr-unprofiled";
+            result.count = 2;
+            break;
+        }
+#else
+        case __FLAG_LTO:
+            result.data[0] = "-flto=auto";
+            result.count = 1;
+            break;
+        case __FLAG_PGO_GENERATE: // .gcda files land next to the objects
+            result.data[0] = "-fprofile-generate";
+            result.count = 1;
+            break;
+        case __FLAG_PGO_USE:
+            result.data[0] = "-fprofile-use";
+            result.data[1] = "-fprofile-partial-training"; // code the training run missed stays at -O2 instead of -Os
+            result.data[2] = "-Wno-missing-profile";
+            result.count = 3;
+            break;
+#endif
         case __FLAG_RAW:
             result.count = 1;
             result.data[0] = flag.str_value;
@@ -279,36 +514,39 @@ FlagStringList flag_to_strings(Flag flag) {
     }
     return result;
 }
-void __Build_Build__(string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length) {
+bool __Build_Build__(string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length) {
     if(!__Build_needs_rebuild__(file, dep, dep_length)) {
         printf("not rebuilding %s\n", file);
-        return;
+        return true;
     }
-    char cmd[BufferSize] = {'\0'};
+    Cmd cmd = {0};
 #ifdef __clang__
-    strcat(cmd, "clang ");
+    Build.cmd.append(&cmd, "clang");
 #else
-    strcat(cmd, "gcc ");
+    Build.cmd.append(&cmd, "gcc");
 #endif
     for(size_t i = 0; i < flag_length; i++) {
         FlagStringList f = flag_to_strings(flags[i]);
         for(size_t ii = 0; ii < f.count; ii++) {
-            strcat(cmd, f.data[ii]);
-            strcat(cmd, " ");
+            Build.cmd.append(&cmd, f.data[ii]);
         }
     }
     for(size_t i = 0; i < dep_length; i++) {
         if(Build.str_ends_with(dep[i], ".h") || Build.str_ends_with(dep[i], ".hpp")){ //ignore anything that isnt a .c
             continue;
         }
-        strcat(cmd, dep[i]);
-        strcat(cmd, " ");
+        Build.cmd.append(&cmd, dep[i]);
+    }
+    Build.cmd.append(&cmd, "-o");
+    Build.cmd.append(&cmd, file);
+    int status = Build.cmd.run(&cmd);
+    Build.cmd.free(&cmd);
+    if(status != 0) {
+        fprintf(stderr, "\033[31mbuilding %s failed (exit code %d)\033[0m\n", file, status);
+        return false;
     }
-    strcat(cmd, "-o ");
-    strcat(cmd, file);
-    printf("running cmd %s\n", cmd);
-    system(cmd);
     printf("done\n");
+    return true;
 }
 #elif defined(_MSC_VER)
 
@@ -365,6 +603,15 @@ FlagStringList flag_to_strings(Flag flag, bool* comp_only) {
                 result.count = 0;
             }
             break;
+        case __FLAG_LTO:
+            result.data[0] = "/GL";    // whole program optimization, cl does /LTCG on link
+            result.count = 1;
+            break;
+        case __FLAG_PGO_GENERATE:
+        case __FLAG_PGO_USE:
+            // cl only does pgo through link.exe /LTCG:PGINSTRUMENT, not supported here
+            result.count = 0;
+            break;
         case __FLAG_RAW:
             result.count = 1;
             result.data[0] = flag.str_value;
@@ -375,55 +622,248 @@ FlagStringList flag_to_strings(Flag flag, bool* comp_only) {
     }
     return result;
 }
-void __Build_Build__(string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length) {
+bool __Build_Build__(string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length) {
     if(!__Build_needs_rebuild__(file, dep, dep_length)) {
         printf("not rebuilding %s\n", file);
-        return;
+        return true;
     }
     bool comp_only = false;
-    char cmd[BufferSize] = {'\0'};
-    strcat(cmd, "cl ");
+    Cmd cmd = {0};
+    Build.cmd.append(&cmd, "cl");
     for(size_t i = 0; i < flag_length; i++) {
         FlagStringList f = flag_to_strings(flags[i], &comp_only);
-        for(size_t ii = 0; ii < f.count; ii++) {
-            strcat(cmd, f.data[ii]);
+        if(f.count == 1) {
+            Build.cmd.append(&cmd, f.data[0]);
+        } else if(f.count == 2) { // cl wants the value glued to the switch, /Ipath
+            Build.cmd.appendf(&cmd, "%s%s", f.data[0], f.data[1]);
         }
-        strcat(cmd, " ");
     }
     for(size_t i = 0; i < dep_length; i++) {
         if(Build.str_ends_with(dep[i], ".h") || Build.str_ends_with(dep[i], ".hpp")){ //ignore anything that isnt a .c
             continue;
         }
-        strcat(cmd, dep[i]);
-        strcat(cmd, " ");
+        Build.cmd.append(&cmd, dep[i]);
     }
-    if(comp_only) {
-        strcat(cmd, "/Fo");
-    } else {
-        strcat(cmd, "/Fe");
+    Build.cmd.appendf(&cmd, "%s%s", comp_only ? "/Fo" : "/Fe", file);
+    int status = Build.cmd.run(&cmd);
+    Build.cmd.free(&cmd);
+    if(status != 0) {
+        fprintf(stderr, "\033[31mbuilding %s failed (exit code %d)\033[0m\n", file, status);
+        return false;
     }
-    strcat(cmd, file);
-    printf("running cmd %s\n", cmd);
-    system(cmd);
     printf("done\n");
+    return true;
 }
 #else
-void __Build_Build__(string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length) {
+bool __Build_Build__(string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length) {
     fprintf(stderr, "\033[31munknown compiler\033[0m\n");
     exit(1);
 }
 #endif
 
-void __Build_fetch_git(string url, bool build) { //build does nothing at the moment
+bool __BUILD__PROFILE_find(string name, Profile* out) {
+    Profile profiles[] = {
+        PROFILE_DEBUG,
+        PROFILE_RELEASE,
+        PROFILE_RELEASE_LTO,
+        PROFILE_PGO_GENERATE,
+        PROFILE_PGO_USE,
+    };
+    for(size_t i = 0; i < sizeof(profiles)/sizeof(Profile); i++) {
+        if(strcmp(profiles[i].name, name) == 0) {
+            *out = profiles[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool __BUILD__PROFILE_build(Profile* profile, string file, string dep[], size_t dep_length, Flag flags[], size_t flag_length) {
+    if(!Build.fs.exists(profile->dir)) {
+        Build.fs.mkdir(profile->dir);
+    }
+    Flag* all = malloc(sizeof(Flag) * (profile->flag_count + flag_length));
+    memcpy(all, profile->flags, sizeof(Flag) * profile->flag_count);
+    memcpy(all + profile->flag_count, flags, sizeof(Flag) * flag_length);
+    bool ok = Build.build(file, dep, dep_length, all, profile->flag_count + flag_length);
+    free(all);
+    return ok;
+}
+
+#ifdef _WIN32
+bool __BUILD__PROFILE_merge_data(Profile* profile) {
+    return true;
+}
+void __BUILD__PROFILE_clean_data(Profile* profile) {
+}
+#else
+// calls fn on every file in dir ending with suffix
+void __Build_for_each_file__(string dir, string suffix, void (*fn)(string path, void* user), void* user) {
+    DIR* d = opendir(dir);
+    if(!d) return;
+    struct dirent* entry;
+    while((entry = readdir(d))) {
+        if(!Build.str_ends_with(entry->d_name, suffix)) continue;
+        char path[BufferSize];
+        snprintf(path, sizeof(path), "%s%s", dir, entry->d_name);
+        fn(path, user);
+    }
+    closedir(d);
+}
+
+void __Build_remove_file__(string path, void* user) {
+    Build.fs.remove(path);
+}
+
+void __Build_append_file__(string path, void* user) {
+    Build.cmd.append((Cmd*)user, path);
+}
+
+bool __BUILD__PROFILE_merge_data(Profile* profile) {
+#ifdef __clang__
+    Cmd cmd = {0};
+    Build.cmd.append(&cmd, "llvm-profdata");
+    Build.cmd.append(&cmd, "merge");
+    Build.cmd.appendf(&cmd, "-output=%sdefault.profdata", profile->dir);
+    size_t before = cmd.count;
+    __Build_for_each_file__(profile->dir, ".profraw", __Build_append_file__, &cmd);
+    if(cmd.count == before) {
+        Build.cmd.free(&cmd);
+        fprintf(stderr, "\033[31mno profile data in %s, did the training run crash?\033[0m\n", profile->dir);
+        return false;
+    }
+    int status = Build.cmd.run(&cmd);
+    Build.cmd.free(&cmd);
+    if(status != 0) {
+        fprintf(stderr, "\033[31mmerging profile data failed (exit code %d)\033[0m\n", status);
+        return false;
+    }
+#endif
+    return true;
+}
+
+void __BUILD__PROFILE_clean_data(Profile* profile) {
+    __Build_for_each_file__(profile->dir, ".gcda", __Build_remove_file__, NULL);
+    __Build_for_each_file__(profile->dir, ".profraw", __Build_remove_file__, NULL);
+    __Build_for_each_file__(profile->dir, ".profdata", __Build_remove_file__, NULL);
+}
+#endif
+
+bool __Build_Embed__(string file, string out) {
+    char header[BufferSize], stub[BufferSize], object[BufferSize], symbol[BufferSize];
+    snprintf(header, sizeof(header), "%s.h", out);
+    snprintf(stub, sizeof(stub), "%s.s", out);
+    snprintf(object, sizeof(object), "%s" _OBJ, out);
+    if(!__Build_needs_rebuild__(object, StringArray(file), 1) && Build.fs.exists(header)) {
+        printf("not rebuilding %s\n", object);
+        return true;
+    }
+
+    string name = strncmp(file, "./", 2) == 0 ? file + 2 : file;
+    size_t len = 0;
+    for(; name[len] && len < sizeof(symbol) - 1; len++) {
+        char c = name[len];
+        bool alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        symbol[len] = alnum ? c : '_';
+    }
+    symbol[len] = '\0';
+
+    FILE* h = fopen(header, "w");
+    if(!h) {
+        fprintf(stderr, "\033[31mcould not write %s\033[0m\n", header);
+        return false;
+    }
+    fprintf(h, "// generated by build.h from %s\n", file);
+    fprintf(h, "#pragma once\n");
+    fprintf(h, "extern const unsigned char %s_start[];\n", symbol);
+    fprintf(h, "extern const unsigned char %s_end[];\n", symbol);
+    fprintf(h, "#define %s_len ((unsigned int)(%s_end - %s_start))\n", symbol, symbol, symbol);
+    fclose(h);
+
+#if defined(_MSC_VER)
+    fprintf(stderr, "\033[31mcl has no .incbin, embedding %s is not supported\033[0m\n", file);
+    return false;
+#else
+#if defined(__APPLE__)
+    string section = ".const";
+    string prefix = "_"; // mach-o C symbols carry a leading underscore
+#elif defined(_WIN32)
+    string section = ".section .rdata,\"dr\"";
+    string prefix = "";
+#else
+    string section = ".section .rodata";
+    string prefix = "";
+#endif
+    FILE* s = fopen(stub, "w");
+    if(!s) {
+        fprintf(stderr, "\033[31mcould not write %s\033[0m\n", stub);
+        return false;
+    }
+    fprintf(s, "    %s\n", section);
+    fprintf(s, "    .globl %s%s_start\n", prefix, symbol);
+    fprintf(s, "    .globl %s%s_end\n", prefix, symbol);
+    fprintf(s, "    .balign 16\n");
+    fprintf(s, "%s%s_start:\n", prefix, symbol);
+    fprintf(s, "    .incbin \"%s\"\n", file);
+    fprintf(s, "%s%s_end:\n", prefix, symbol);
+    fprintf(s, "    .byte 0\n");
+#if !defined(__APPLE__) && !defined(_WIN32)
+    fprintf(s, "    .section .note.GNU-stack,\"\",@progbits\n");
+#endif
+    fclose(s);
+
+    Cmd cmd = {0};
+#ifdef __clang__
+    Build.cmd.append(&cmd, "clang");
+#else
+    Build.cmd.append(&cmd, "gcc");
+#endif
+    Build.cmd.append(&cmd, "-c");
+    Build.cmd.append(&cmd, stub);
+    Build.cmd.append(&cmd, "-o");
+    Build.cmd.append(&cmd, object);
+    int status = Build.cmd.run(&cmd);
+    Build.cmd.free(&cmd);
+    if(status != 0) {
+        fprintf(stderr, "\033[31membedding %s failed (exit code %d)\033[0m\n", file, status);
+        return false;
+    }
+    printf("done\n");
+    return true;
+#endif
+}
+
+bool __Build_fetch_git(string url, bool build) { //build does nothing at the moment
     if(!Build.fs.exists("./deps/")) {
         Build.fs.mkdir("./deps/");
     }
+    // clone lands in ./deps/<last path component without .git>
+    string name = strrchr(url, '/') ? strrchr(url, '/') + 1 : url;
+    size_t name_len = strlen(name);
+    if(Build.str_ends_with(name, ".git")) name_len -= 4;
+    char dir[BufferSize];
+    snprintf(dir, sizeof(dir), "./deps/%.*s", (int)name_len, name);
+    if(Build.fs.exists(dir)) {
+        printf("not fetching %s\n", url);
+        return true;
+    }
     printf("fetching %s\n", url);
-    char cmd[BufferSize] = {'\0'};
-    strcat(cmd, "git -C ./deps/ clone --depth=1 --single-branch ");
-    strcat(cmd, url);
-    system(cmd);
+    Cmd cmd = {0};
+    Build.cmd.append(&cmd, "git");
+    Build.cmd.append(&cmd, "-C");
+    Build.cmd.append(&cmd, "./deps/");
+    Build.cmd.append(&cmd, "clone");
+    Build.cmd.append(&cmd, "--depth=1");
+    Build.cmd.append(&cmd, "--single-branch");
+    Build.cmd.append(&cmd, url);
+    int status = Build.cmd.run(&cmd);
+    Build.cmd.free(&cmd);
+    if(status != 0) {
+        fprintf(stderr, "\033[31mfetching %s failed (exit code %d)\033[0m\n", url, status);
+        return false;
+    }
     printf("done\n");
+    return true;
 }
 
 int __Build_Main__(int argc, char **argv);
@@ -438,6 +878,17 @@ int __Build_Main__(int argc, char **argv);
         Build.fs.copy = __BUILD__FS_copy; \
         Build.fs.move = __BUILD__FS_fs_move; \
         Build.fs.remove = __BUILD__FS_remove; \
+        Build.cmd.append = __BUILD__CMD_append; \
+        Build.cmd.appendf = __BUILD__CMD_appendf; \
+        Build.cmd.run = __BUILD__CMD_run; \
+        Build.cmd.run_redirect = __BUILD__CMD_run_redirect; \
+        Build.cmd.reset = __BUILD__CMD_reset; \
+        Build.cmd.free = __BUILD__CMD_free; \
+        Build.profile.find = __BUILD__PROFILE_find; \
+        Build.profile.build = __BUILD__PROFILE_build; \
+        Build.profile.merge_data = __BUILD__PROFILE_merge_data; \
+        Build.profile.clean_data = __BUILD__PROFILE_clean_data; \
+        Build.embed = __Build_Embed__; \
         Build.fetch_git = __Build_fetch_git; \
         __Build_Bootstrap__(); \
         return __Build_Main__(argc, argv); \
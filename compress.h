@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// palette compression of byte arrays, every value is replaced by its index in a palette of the distinct
+// values and the indices are packed with as few bits as hold them, rounded up to 0, 1, 2, 4 or 8 so an
+// index never straddles two bytes
+// layout: palette size - 1, bits per index, palette, packed indices
+#define PACKED_MAX_BYTES(count) (2 + 256 + (count))
+
+int packed_bits(int palette_len) {
+    if (palette_len <= 1) return 0;
+    if (palette_len <= 2) return 1;
+    if (palette_len <= 4) return 2;
+    if (palette_len <= 16) return 4;
+    return 8;
+}
+
+// count must be a multiple of 8, out needs PACKED_MAX_BYTES(count), returns the bytes written
+size_t pack_bytes(const uint8_t* in, size_t count, uint8_t* out) {
+    uint8_t index[256];
+    bool seen[256] = {0};
+    uint8_t* palette = out + 2;
+    int palette_len = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (seen[in[i]]) continue;
+        seen[in[i]] = true;
+        index[in[i]] = palette_len;
+        palette[palette_len++] = in[i];
+    }
+    int bits = packed_bits(palette_len);
+    out[0] = palette_len - 1;
+    out[1] = bits;
+    uint8_t* data = palette + palette_len;
+    if (bits == 0) return 2 + palette_len;
+    if (bits == 8) {
+        for (size_t i = 0; i < count; i++) data[i] = index[in[i]];
+        return 2 + palette_len + count;
+    }
+    int per_byte = 8 / bits;
+    size_t bytes = count / per_byte;
+    for (size_t i = 0; i < bytes; i++) {
+        uint8_t packed = 0;
+        for (int j = 0; j < per_byte; j++) packed |= index[in[i * per_byte + j]] << (j * bits);
+        data[i] = packed;
+    }
+    return 2 + palette_len + bytes;
+}
+
+// inverse of pack_bytes, returns the bytes read from in
+size_t unpack_bytes(const uint8_t* in, size_t count, uint8_t* out) {
+    int palette_len = in[0] + 1;
+    int bits = in[1];
+    const uint8_t* palette = in + 2;
+    const uint8_t* data = palette + palette_len;
+    if (bits == 0) {
+        memset(out, palette[0], count);
+        return 2 + palette_len;
+    }
+    if (bits == 8) {
+        for (size_t i = 0; i < count; i++) out[i] = palette[data[i]];
+        return 2 + palette_len + count;
+    }
+    int per_byte = 8 / bits;
+    uint8_t mask = (1 << bits) - 1;
+    size_t bytes = count / per_byte;
+    for (size_t i = 0; i < bytes; i++) {
+        uint8_t packed = data[i];
+        for (int j = 0; j < per_byte; j++) out[i * per_byte + j] = palette[(packed >> (j * bits)) & mask];
+    }
+    return 2 + palette_len + bytes;
+}
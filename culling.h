@@ -0,0 +1,109 @@
+#pragma once
+#include <stdint.h>
+#include <cglm/cglm.h>
+#include "world.h"
+
+// chunks to draw this frame as indices into World.chunks in y, z, x order, nearest first so early depth testing
+// rejects what the near chunks already cover
+typedef struct {
+    uint16_t chunks[WORLD_CHUNK_COUNT];
+    float distances[WORLD_CHUNK_COUNT]; // squared, from the camera to the chunk's center
+    size_t count;
+} VisibleChunks;
+
+#define CHUNK_SLOT(x, y, z) ((((y) * WORLD_CHUNKS_XZ) + (z)) * WORLD_CHUNKS_XZ + (x))
+#define OPPOSITE_FACE(face) ((face) ^ 1)
+
+bool chunk_in_frustum(int cx, int cy, int cz, vec4 planes[6]) {
+    vec3 box[2] = {
+        { cx * CHUNK_SIZE - 0.5f, cy * CHUNK_SIZE - 0.5f, cz * CHUNK_SIZE - 0.5f },
+        { (cx + 1) * CHUNK_SIZE - 0.5f, (cy + 1) * CHUNK_SIZE - 0.5f, (cz + 1) * CHUNK_SIZE - 0.5f },
+    };
+    return glm_aabb_frustum(box, planes);
+}
+
+void add_visible_chunk(VisibleChunks* out, int x, int y, int z, vec3 eye) {
+    vec3 center = {
+        (x + WORLD_MIN_XZ) * CHUNK_SIZE - 0.5f + CHUNK_SIZE / 2.0f,
+        (y + WORLD_MIN_Y) * CHUNK_SIZE - 0.5f + CHUNK_SIZE / 2.0f,
+        (z + WORLD_MIN_XZ) * CHUNK_SIZE - 0.5f + CHUNK_SIZE / 2.0f,
+    };
+    out->distances[out->count] = glm_vec3_distance2(center, eye);
+    out->chunks[out->count++] = CHUNK_SLOT(x, y, z);
+}
+
+// the search already reaches chunks in about the order of their distance, insertion sort is close to linear on it
+void sort_visible_chunks(VisibleChunks* visible) {
+    for (size_t i = 1; i < visible->count; i++) {
+        uint16_t chunk = visible->chunks[i];
+        float distance = visible->distances[i];
+        size_t j = i;
+        for (; j > 0 && visible->distances[j - 1] > distance; j--) {
+            visible->chunks[j] = visible->chunks[j - 1];
+            visible->distances[j] = visible->distances[j - 1];
+        }
+        visible->chunks[j] = chunk;
+        visible->distances[j] = distance;
+    }
+}
+
+// breadth first search over chunks starting at the camera's chunk
+// a neighbor is only reached through a face the current chunk's air connects to the face it was entered through,
+// if it's in the frustum and without stepping back against a direction the search already went in
+// planes are the camera's frustum planes as glm_frustum_planes returns them
+void cull_chunks(World* world, vec3 eye, vec4 planes[6], VisibleChunks* out) {
+    out->count = 0;
+
+    int start[3] = {
+        BLOCK_TO_CHUNK((int)floorf(eye[0] + 0.5f)) - WORLD_MIN_XZ,
+        BLOCK_TO_CHUNK((int)floorf(eye[1] + 0.5f)) - WORLD_MIN_Y,
+        BLOCK_TO_CHUNK((int)floorf(eye[2] + 0.5f)) - WORLD_MIN_XZ,
+    };
+    if (!world_chunk_in_bounds(start[0] + WORLD_MIN_XZ, start[1] + WORLD_MIN_Y, start[2] + WORLD_MIN_XZ)) {
+        // nothing to search from outside the world, frustum culling only
+        for (int y = 0; y < WORLD_CHUNKS_Y; y++) {
+            for (int z = 0; z < WORLD_CHUNKS_XZ; z++) {
+                for (int x = 0; x < WORLD_CHUNKS_XZ; x++) {
+                    if (chunk_in_frustum(x + WORLD_MIN_XZ, y + WORLD_MIN_Y, z + WORLD_MIN_XZ, planes)) {
+                        add_visible_chunk(out, x, y, z, eye);
+                    }
+                }
+            }
+        }
+        sort_visible_chunks(out);
+        return;
+    }
+
+    bool visited[WORLD_CHUNK_COUNT] = {0};
+    uint8_t entered[WORLD_CHUNK_COUNT];    // face the search came in through, FACE_NONE for the camera's chunk
+    uint8_t directions[WORLD_CHUNK_COUNT]; // faces stepped through on the way here
+    int slot = CHUNK_SLOT(start[0], start[1], start[2]);
+    visited[slot] = true;
+    entered[slot] = FACE_NONE;
+    directions[slot] = 0;
+    add_visible_chunk(out, start[0], start[1], start[2], eye);
+    // the output doubles as the queue, every chunk reached gets drawn
+    for (size_t head = 0; head < out->count; head++) {
+        slot = out->chunks[head];
+        int x = slot % WORLD_CHUNKS_XZ;
+        int z = slot / WORLD_CHUNKS_XZ % WORLD_CHUNKS_XZ;
+        int y = slot / (WORLD_CHUNKS_XZ * WORLD_CHUNKS_XZ);
+        Chunk* chunk = world->chunks[y][z][x];
+        uint8_t links = entered[slot] == FACE_NONE ? ALL_FACES : chunk ? chunk->visibility[entered[slot]] : ALL_FACES;
+        for (int face = 0; face < 6; face++) {
+            if (!(links & (1 << face)) || directions[slot] & (1 << OPPOSITE_FACE(face))) continue;
+            int nx = x + FACE_NORMALS[face][0];
+            int ny = y + FACE_NORMALS[face][1];
+            int nz = z + FACE_NORMALS[face][2];
+            if (!world_chunk_in_bounds(nx + WORLD_MIN_XZ, ny + WORLD_MIN_Y, nz + WORLD_MIN_XZ)) continue;
+            int next = CHUNK_SLOT(nx, ny, nz);
+            if (visited[next]) continue;
+            visited[next] = true;
+            if (!chunk_in_frustum(nx + WORLD_MIN_XZ, ny + WORLD_MIN_Y, nz + WORLD_MIN_XZ, planes)) continue;
+            entered[next] = OPPOSITE_FACE(face);
+            directions[next] = directions[slot] | 1 << face;
+            add_visible_chunk(out, nx, ny, nz, eye);
+        }
+    }
+    sort_visible_chunks(out);
+}
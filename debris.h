@@ -0,0 +1,105 @@
+#pragma once
+#include <stdlib.h>
+#include <cglm/cglm.h>
+#include "world.h"
+#include "physics.h"
+#include "light.h"
+
+// pieces a broken block falls apart into, they bounce around for a moment and are never meshed into a chunk
+#define DEBRIS_PER_AXIS 3
+#define DEBRIS_MAX 8192
+#define DEBRIS_LIFETIME 1.2f
+#define DEBRIS_SHRINK_TIME 0.25f // pieces shrink away over the end of their life instead of popping out
+#define DEBRIS_GRAVITY 20.0f
+#define DEBRIS_SPEED 3.0f
+#define DEBRIS_GROUND_FRICTION 0.85f // speed kept per 1/60 s on the ground
+#define DEBRIS_MAX_STEP 0.1f // longer frames are simulated as this long so a stall doesn't fling pieces
+
+typedef struct {
+    BlockId block;
+    float yaw;        // radians
+    float spin;       // radians per second
+    float life;       // seconds left
+    float brightness; // sampled while the world lock is held, the last sample is kept otherwise
+} DebrisPiece;
+
+// bodies are kept apart from the rest so every piece moves in one physics_step call
+typedef struct {
+    Body bodies[DEBRIS_MAX];
+    DebrisPiece pieces[DEBRIS_MAX];
+    size_t count;
+} Debris;
+
+float random_unit() {
+    return rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+// splits the block at x, y, z into pieces flying outwards from its center, pieces past DEBRIS_MAX are dropped
+void debris_burst(Debris* debris, BlockId block, int x, int y, int z, float brightness) {
+    float size = 1.0f / DEBRIS_PER_AXIS;
+    for (int i = 0; i < DEBRIS_PER_AXIS * DEBRIS_PER_AXIS * DEBRIS_PER_AXIS && debris->count < DEBRIS_MAX; i++) {
+        vec3 offset = {
+            (i % DEBRIS_PER_AXIS + 0.5f) * size - 0.5f,
+            (i / DEBRIS_PER_AXIS % DEBRIS_PER_AXIS + 0.5f) * size - 0.5f,
+            (i / (DEBRIS_PER_AXIS * DEBRIS_PER_AXIS) + 0.5f) * size - 0.5f,
+        };
+        Body* body = &debris->bodies[debris->count];
+        *body = (Body){
+            .center = { x + offset[0], y + offset[1], z + offset[2] },
+            .half_extents = { size / 2, size / 2, size / 2 },
+            .velocity = {
+                offset[0] * DEBRIS_SPEED + random_unit(),
+                offset[1] * DEBRIS_SPEED + DEBRIS_SPEED,
+                offset[2] * DEBRIS_SPEED + random_unit(),
+            },
+            .gravity = DEBRIS_GRAVITY,
+        };
+        debris->pieces[debris->count++] = (DebrisPiece){
+            .block = block,
+            .yaw = random_unit() * GLM_PIf,
+            .spin = random_unit() * 2.0f * GLM_PIf,
+            .life = DEBRIS_LIFETIME * (0.75f + 0.25f * random_unit()),
+            .brightness = brightness,
+        };
+    }
+}
+
+// moves every piece and removes the ones whose time is up, order isn't kept
+void debris_step(Debris* debris, World* world, float dt) {
+    if (dt > DEBRIS_MAX_STEP) dt = DEBRIS_MAX_STEP;
+    physics_step(world, debris->bodies, debris->count, dt);
+    float friction = powf(DEBRIS_GROUND_FRICTION, dt * 60.0f); // same slowdown at any frame rate
+    for (size_t i = 0; i < debris->count;) {
+        Body* body = &debris->bodies[i];
+        DebrisPiece* piece = &debris->pieces[i];
+        piece->life -= dt;
+        if (piece->life <= 0.0f) {
+            debris->count--;
+            debris->bodies[i] = debris->bodies[debris->count];
+            debris->pieces[i] = debris->pieces[debris->count];
+            continue;
+        }
+        if (body->on_ground) {
+            body->velocity[0] *= friction;
+            body->velocity[2] *= friction;
+            piece->spin *= friction;
+        }
+        piece->yaw += piece->spin * dt;
+        i++;
+    }
+}
+
+// the caller holds the light engine's world lock
+void debris_sample_light(Debris* debris, World* world) {
+    for (size_t i = 0; i < debris->count; i++) {
+        float* center = debris->bodies[i].center;
+        uint8_t light = world_get_light(world, block_cell(center[0]), block_cell(center[1]), block_cell(center[2]));
+        debris->pieces[i].brightness = light_brightness(light);
+    }
+}
+
+// edge length a piece is drawn with
+float debris_scale(DebrisPiece* piece) {
+    float scale = 1.0f / DEBRIS_PER_AXIS;
+    return piece->life < DEBRIS_SHRINK_TIME ? scale * piece->life / DEBRIS_SHRINK_TIME : scale;
+}
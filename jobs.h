@@ -0,0 +1,111 @@
+#pragma once
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "arena.h"
+
+// small pool of worker threads for one off jobs like decoding textures at startup
+typedef void (*JobFunction)(void* arg);
+
+// jobs submitted together, a group can be waited on without waiting for every other job in the pool
+typedef struct {
+    atomic_int pending;
+} JobGroup;
+
+typedef struct {
+    JobFunction function;
+    void* arg;
+    JobGroup* group; // can be NULL
+} Job;
+
+#define JOB_QUEUE_SIZE 256
+#define MAX_WORKERS 8
+
+typedef struct {
+    pthread_t threads[MAX_WORKERS];
+    int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t wake; // signaled when a job is queued or the pool stops
+    pthread_cond_t done; // broadcast whenever a job finishes
+    Job queue[JOB_QUEUE_SIZE]; // ring buffer
+    size_t head;
+    size_t count;
+    bool quit;
+} JobPool;
+
+void* job_worker(void* arg) {
+    JobPool* pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->quit && pool->count == 0) pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->count == 0) break; // quitting once the queue is drained
+        Job job = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % JOB_QUEUE_SIZE;
+        pool->count--;
+        pthread_mutex_unlock(&pool->lock);
+
+        job.function(job.arg);
+        arena_reset(scratch_arena());
+
+        pthread_mutex_lock(&pool->lock);
+        if (job.group) atomic_fetch_sub(&job.group->pending, 1);
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    free_scratch_arena();
+    return NULL;
+}
+
+// one worker per core besides the calling thread, at least one
+bool job_pool_start(JobPool* pool) {
+    *pool = (JobPool){0};
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores > 1 ? (int)cores - 1 : 1;
+    if (threads > MAX_WORKERS) threads = MAX_WORKERS;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, job_worker, pool) != 0) break;
+        pool->thread_count++;
+    }
+    return pool->thread_count > 0;
+}
+
+// runs the job on the calling thread when the queue is full
+void job_submit(JobPool* pool, JobFunction function, void* arg, JobGroup* group) {
+    if (group) atomic_fetch_add(&group->pending, 1);
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == JOB_QUEUE_SIZE || pool->thread_count == 0) {
+        pthread_mutex_unlock(&pool->lock);
+        function(arg);
+        pthread_mutex_lock(&pool->lock);
+        if (group) atomic_fetch_sub(&group->pending, 1);
+        pthread_cond_broadcast(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    pool->queue[(pool->head + pool->count) % JOB_QUEUE_SIZE] = (Job){ function, arg, group };
+    pool->count++;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void job_group_wait(JobPool* pool, JobGroup* group) {
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&group->pending) > 0) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// finishes the queued jobs and joins the workers
+void job_pool_stop(JobPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->thread_count; i++) pthread_join(pool->threads[i], NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+}
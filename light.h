@@ -0,0 +1,378 @@
+#pragma once
+#include <stdio.h>
+#include <math.h>
+#include <pthread.h>
+#include "world.h"
+
+// sky and block light are flood filled separately, every step into a non opaque block costs one level
+// sky light at full strength goes straight down without losing any
+typedef enum {
+    LIGHT_CHANNEL_BLOCK,
+    LIGHT_CHANNEL_SKY,
+} LightChannel;
+
+typedef struct {
+    int16_t x, y, z;
+    uint8_t level;
+} LightNode;
+
+// ring buffer, a flood fill only keeps its frontier in here so it stays far below the size
+#define LIGHT_QUEUE_SIZE (1 << 16)
+
+typedef struct {
+    LightNode nodes[LIGHT_QUEUE_SIZE];
+    size_t head;
+    size_t count;
+    size_t dropped; // pushes that didn't fit, their light is lost
+} LightQueue;
+
+void light_queue_push(LightQueue* queue, int x, int y, int z, int level) {
+    if (queue->count == LIGHT_QUEUE_SIZE) {
+        queue->dropped++;
+        return;
+    }
+    queue->nodes[(queue->head + queue->count++) & (LIGHT_QUEUE_SIZE - 1)] = (LightNode){ x, y, z, level };
+}
+
+LightNode light_queue_pop(LightQueue* queue) {
+    LightNode node = queue->nodes[queue->head];
+    queue->head = (queue->head + 1) & (LIGHT_QUEUE_SIZE - 1);
+    queue->count--;
+    return node;
+}
+
+// chunks whose light changed, a chunk is in here at most once
+typedef struct {
+    Chunk* chunks[WORLD_CHUNK_COUNT];
+    bool listed[WORLD_CHUNK_COUNT];
+    size_t count;
+} LightChanges;
+
+void light_changes_add(LightChanges* changes, World* world, int cx, int cy, int cz) {
+    Chunk* chunk = world_get_chunk(world, cx, cy, cz);
+    if (!chunk) return;
+    int slot = ((cy - WORLD_MIN_Y) * WORLD_CHUNKS_XZ + cz - WORLD_MIN_XZ) * WORLD_CHUNKS_XZ + cx - WORLD_MIN_XZ;
+    if (changes->listed[slot]) return;
+    changes->listed[slot] = true;
+    changes->chunks[changes->count++] = chunk;
+}
+
+void light_changes_clear(LightChanges* changes) {
+    memset(changes->listed, 0, sizeof(changes->listed));
+    changes->count = 0;
+}
+
+// state of one flood fill, only touched by the thread running it
+typedef struct {
+    World* world;
+    LightQueue add;
+    LightQueue remove;
+    LightChanges changes;
+} Lighter;
+
+int light_get(World* world, LightChannel channel, int x, int y, int z) {
+    uint8_t light = world_get_light(world, x, y, z);
+    return channel == LIGHT_CHANNEL_SKY ? LIGHT_SKY(light) : LIGHT_BLOCK(light);
+}
+
+// returns false for blocks in missing chunks, those keep their empty chunk light
+bool light_set(Lighter* lighter, LightChannel channel, int x, int y, int z, int level) {
+    int cx = BLOCK_TO_CHUNK(x), cy = BLOCK_TO_CHUNK(y), cz = BLOCK_TO_CHUNK(z);
+    Chunk* chunk = world_get_chunk(lighter->world, cx, cy, cz);
+    if (!chunk) return false;
+    int lx = BLOCK_TO_LOCAL(x), ly = BLOCK_TO_LOCAL(y), lz = BLOCK_TO_LOCAL(z);
+    uint8_t* light = &chunk->light[CHUNK_INDEX(lx, ly, lz)];
+    *light = channel == LIGHT_CHANNEL_SKY ? (*light & 0x0f) | level << 4 : (*light & 0xf0) | level;
+    // faces of the neighbors are lit by the blocks on this side of the border, diagonal ones included
+    int min[3], max[3];
+    block_chunk_span(x, y, z, min, max);
+    for (int dy = min[1]; dy <= max[1]; dy++) {
+        for (int dz = min[2]; dz <= max[2]; dz++) {
+            for (int dx = min[0]; dx <= max[0]; dx++) {
+                light_changes_add(&lighter->changes, lighter->world, cx + dx, cy + dy, cz + dz);
+            }
+        }
+    }
+    return true;
+}
+
+// brightness a face is drawn with, each level is 80% of the next brighter one
+float light_brightness(uint8_t light) {
+    int level = LIGHT_SKY(light) > LIGHT_BLOCK(light) ? LIGHT_SKY(light) : LIGHT_BLOCK(light);
+    return powf(0.8f, LIGHT_MAX - level);
+}
+
+// level light at level has when it reaches a neighbor through face
+int light_spread(LightChannel channel, int level, int face) {
+    if (channel == LIGHT_CHANNEL_SKY && face == FACE_NEG_Y && level == LIGHT_MAX) return LIGHT_MAX;
+    return level - 1;
+}
+
+// spreads everything in the add queue until no block gets any brighter
+void light_propagate(Lighter* lighter, LightChannel channel) {
+    World* world = lighter->world;
+    while (lighter->add.count) {
+        LightNode node = light_queue_pop(&lighter->add);
+        int level = light_get(world, channel, node.x, node.y, node.z);
+        if (level <= 1) continue;
+        for (int face = 0; face < 6; face++) {
+            int x = node.x + FACE_NORMALS[face][0];
+            int y = node.y + FACE_NORMALS[face][1];
+            int z = node.z + FACE_NORMALS[face][2];
+            int next = light_spread(channel, level, face);
+            if (next <= light_get(world, channel, x, y, z)) continue;
+            if (block_opaque(world_get_block(world, x, y, z))) continue;
+            if (light_set(lighter, channel, x, y, z, next)) light_queue_push(&lighter->add, x, y, z, next);
+        }
+    }
+}
+
+// darkens everything that got its light from the nodes in the remove queue, nodes carry the level they had
+// brighter neighbors lit from elsewhere and emitters inside the region go to the add queue to fill it back in
+void light_unpropagate(Lighter* lighter, LightChannel channel) {
+    World* world = lighter->world;
+    while (lighter->remove.count) {
+        LightNode node = light_queue_pop(&lighter->remove);
+        for (int face = 0; face < 6; face++) {
+            int x = node.x + FACE_NORMALS[face][0];
+            int y = node.y + FACE_NORMALS[face][1];
+            int z = node.z + FACE_NORMALS[face][2];
+            int level = light_get(world, channel, x, y, z);
+            if (level == 0) continue;
+            if (level < node.level || light_spread(channel, node.level, face) == level) {
+                if (!light_set(lighter, channel, x, y, z, 0)) continue;
+                light_queue_push(&lighter->remove, x, y, z, level);
+                int emission = channel == LIGHT_CHANNEL_BLOCK ? Blocks.emission[world_get_block(world, x, y, z)] : 0;
+                if (emission) {
+                    light_set(lighter, channel, x, y, z, emission);
+                    light_queue_push(&lighter->add, x, y, z, emission);
+                }
+            } else {
+                light_queue_push(&lighter->add, x, y, z, level);
+            }
+        }
+    }
+}
+
+// relights around a block that changed from old_id, the new block is already in the world
+// only the region the old and new light reach is visited
+void light_block_changed(Lighter* lighter, int x, int y, int z, BlockId old_id) {
+    World* world = lighter->world;
+    BlockId id = world_get_block(world, x, y, z);
+    for (LightChannel channel = LIGHT_CHANNEL_BLOCK; channel <= LIGHT_CHANNEL_SKY; channel++) {
+        if (channel == LIGHT_CHANNEL_SKY && block_opaque(id) == block_opaque(old_id)) continue;
+        int level = light_get(world, channel, x, y, z);
+        if (level && light_set(lighter, channel, x, y, z, 0)) {
+            light_queue_push(&lighter->remove, x, y, z, level);
+            light_unpropagate(lighter, channel);
+        }
+        if (!block_opaque(id)) {
+            // pull light back in from every side
+            for (int face = 0; face < 6; face++) {
+                int nx = x + FACE_NORMALS[face][0], ny = y + FACE_NORMALS[face][1], nz = z + FACE_NORMALS[face][2];
+                if (light_get(world, channel, nx, ny, nz)) light_queue_push(&lighter->add, nx, ny, nz, 0);
+            }
+        }
+        int emission = channel == LIGHT_CHANNEL_BLOCK ? Blocks.emission[id] : 0;
+        if (emission && light_set(lighter, channel, x, y, z, emission)) {
+            light_queue_push(&lighter->add, x, y, z, emission);
+        }
+        light_propagate(lighter, channel);
+    }
+}
+
+// lights the whole world from scratch, sky light falls down every column and then both channels are flood filled
+void light_world(Lighter* lighter) {
+    World* world = lighter->world;
+    for (int cz = WORLD_MIN_XZ; cz < WORLD_MIN_XZ + WORLD_CHUNKS_XZ; cz++) {
+        for (int cx = WORLD_MIN_XZ; cx < WORLD_MIN_XZ + WORLD_CHUNKS_XZ; cx++) {
+            for (int z = 0; z < CHUNK_SIZE; z++) {
+                for (int x = 0; x < CHUNK_SIZE; x++) {
+                    int sky = LIGHT_MAX;
+                    for (int cy = WORLD_MIN_Y + WORLD_CHUNKS_Y - 1; cy >= WORLD_MIN_Y; cy--) {
+                        Chunk* chunk = world_get_chunk(world, cx, cy, cz);
+                        if (!chunk) continue;
+                        for (int y = CHUNK_MASK; y >= 0; y--) {
+                            int index = CHUNK_INDEX(x, y, z);
+                            if (block_opaque(chunk->blocks[index])) sky = 0;
+                            chunk->light[index] = sky << 4 | Blocks.emission[chunk->blocks[index]];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    // block light spreads from every emitter, sky light only into dark blocks next to a column that sees the sky
+    for (LightChannel channel = LIGHT_CHANNEL_BLOCK; channel <= LIGHT_CHANNEL_SKY; channel++) {
+        for (int cy = WORLD_MIN_Y; cy < WORLD_MIN_Y + WORLD_CHUNKS_Y; cy++) {
+            for (int cz = WORLD_MIN_XZ; cz < WORLD_MIN_XZ + WORLD_CHUNKS_XZ; cz++) {
+                for (int cx = WORLD_MIN_XZ; cx < WORLD_MIN_XZ + WORLD_CHUNKS_XZ; cx++) {
+                    Chunk* chunk = world_get_chunk(world, cx, cy, cz);
+                    if (!chunk) continue;
+                    for (int index = 0; index < CHUNK_VOLUME; index++) {
+                        uint8_t light = chunk->light[index];
+                        int x = cx * CHUNK_SIZE + (index & CHUNK_MASK);
+                        int y = cy * CHUNK_SIZE + (index >> (2 * CHUNK_SHIFT));
+                        int z = cz * CHUNK_SIZE + ((index >> CHUNK_SHIFT) & CHUNK_MASK);
+                        if (channel == LIGHT_CHANNEL_BLOCK) {
+                            if (LIGHT_BLOCK(light)) light_queue_push(&lighter->add, x, y, z, LIGHT_BLOCK(light));
+                        } else if (!block_opaque(chunk->blocks[index]) && !LIGHT_SKY(light)) {
+                            for (int face = 0; face < 6; face++) {
+                                int nx = x + FACE_NORMALS[face][0], ny = y + FACE_NORMALS[face][1], nz = z + FACE_NORMALS[face][2];
+                                if (light_get(world, channel, nx, ny, nz) > 1) light_queue_push(&lighter->add, nx, ny, nz, 0);
+                            }
+                        }
+                        // keep the seeds from filling the queue
+                        if (lighter->add.count > LIGHT_QUEUE_SIZE - 6) light_propagate(lighter, channel);
+                    }
+                }
+            }
+        }
+        light_propagate(lighter, channel);
+    }
+}
+
+// a block edit the light thread still has to handle
+typedef struct {
+    int x, y, z;
+    BlockId old_id;
+} LightEdit;
+
+#define LIGHT_MAX_EDITS 256
+
+// runs lighting on its own thread, the main thread hands it edits and picks up the chunks it changed
+typedef struct {
+    Lighter* lighter;
+    pthread_t thread;
+    // held while lighting, also needed to write blocks or to read light from the main thread
+    pthread_mutex_t world_lock;
+    // guards everything below
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    LightEdit edits[LIGHT_MAX_EDITS];
+    size_t edit_count;
+    bool relight_all;
+    bool busy;
+    bool quit;
+    LightChanges changes; // chunks to remesh
+} LightEngine;
+
+void* light_thread(void* arg) {
+    LightEngine* engine = arg;
+    Lighter* lighter = engine->lighter;
+    LightEdit edits[LIGHT_MAX_EDITS];
+    for (;;) {
+        pthread_mutex_lock(&engine->lock);
+        while (!engine->quit && !engine->relight_all && engine->edit_count == 0) {
+            pthread_cond_wait(&engine->wake, &engine->lock);
+        }
+        if (engine->quit) {
+            pthread_mutex_unlock(&engine->lock);
+            return NULL;
+        }
+        bool relight_all = engine->relight_all;
+        size_t edit_count = engine->edit_count;
+        memcpy(edits, engine->edits, sizeof(LightEdit) * edit_count);
+        engine->relight_all = false;
+        engine->edit_count = 0;
+        engine->busy = true;
+        pthread_mutex_unlock(&engine->lock);
+
+        pthread_mutex_lock(&engine->world_lock);
+        light_changes_clear(&lighter->changes);
+        if (relight_all) {
+            light_world(lighter);
+        } else {
+            for (size_t i = 0; i < edit_count; i++) {
+                light_block_changed(lighter, edits[i].x, edits[i].y, edits[i].z, edits[i].old_id);
+            }
+        }
+        pthread_mutex_unlock(&engine->world_lock);
+        if (lighter->add.dropped || lighter->remove.dropped) {
+            fprintf(stderr, "\033[31mlight queue overflowed, %zu updates dropped\033[0m\n", lighter->add.dropped + lighter->remove.dropped);
+            lighter->add.dropped = lighter->remove.dropped = 0;
+        }
+
+        pthread_mutex_lock(&engine->lock);
+        for (size_t i = 0; i < lighter->changes.count; i++) {
+            Chunk* chunk = lighter->changes.chunks[i];
+            light_changes_add(&engine->changes, lighter->world, chunk->cx, chunk->cy, chunk->cz);
+        }
+        engine->busy = false;
+        pthread_cond_broadcast(&engine->idle);
+        pthread_mutex_unlock(&engine->lock);
+    }
+}
+
+Lighter* new_Lighter(World* world) {
+    Lighter* lighter = mem_calloc(MEM_JOBS, 1, sizeof(Lighter));
+    if (lighter) lighter->world = world;
+    return lighter;
+}
+
+void free_Lighter(Lighter* lighter) {
+    mem_free(MEM_JOBS, lighter, sizeof(Lighter));
+}
+
+// starts the light thread and has it light the whole world
+bool light_engine_start(LightEngine* engine, World* world) {
+    memset(engine, 0, sizeof(*engine));
+    engine->lighter = new_Lighter(world);
+    if (!engine->lighter) return false;
+    pthread_mutex_init(&engine->world_lock, NULL);
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->wake, NULL);
+    pthread_cond_init(&engine->idle, NULL);
+    engine->relight_all = true;
+    if (pthread_create(&engine->thread, NULL, light_thread, engine) != 0) {
+        free_Lighter(engine->lighter);
+        return false;
+    }
+    return true;
+}
+
+// queues a block change for relighting, the caller holds world_lock and already wrote the new block
+void light_engine_edit(LightEngine* engine, int x, int y, int z, BlockId old_id) {
+    pthread_mutex_lock(&engine->lock);
+    if (engine->edit_count == LIGHT_MAX_EDITS) {
+        engine->relight_all = true; // too many at once, start over
+        engine->edit_count = 0;
+    } else if (!engine->relight_all) {
+        engine->edits[engine->edit_count++] = (LightEdit){ x, y, z, old_id };
+    }
+    pthread_cond_signal(&engine->wake);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+// blocks until everything queued so far is lit
+void light_engine_wait(LightEngine* engine) {
+    pthread_mutex_lock(&engine->lock);
+    while (engine->busy || engine->relight_all || engine->edit_count) {
+        pthread_cond_wait(&engine->idle, &engine->lock);
+    }
+    pthread_mutex_unlock(&engine->lock);
+}
+
+// queues every chunk the light thread finished relighting for remeshing
+void light_engine_collect(LightEngine* engine, World* world) {
+    pthread_mutex_lock(&engine->lock);
+    for (size_t i = 0; i < engine->changes.count; i++) {
+        world_mark_dirty(world, engine->changes.chunks[i]);
+    }
+    light_changes_clear(&engine->changes);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+void light_engine_stop(LightEngine* engine) {
+    pthread_mutex_lock(&engine->lock);
+    engine->quit = true;
+    pthread_cond_signal(&engine->wake);
+    pthread_mutex_unlock(&engine->lock);
+    pthread_join(engine->thread, NULL);
+    pthread_cond_destroy(&engine->wake);
+    pthread_cond_destroy(&engine->idle);
+    pthread_mutex_destroy(&engine->lock);
+    pthread_mutex_destroy(&engine->world_lock);
+    free_Lighter(engine->lighter);
+}
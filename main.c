@@ -10,27 +10,47 @@
 #include <assets/shaders/frag.h>
 #include <assets/textures/cobbled_stone.h>
 #include <assets/shaders/geo.h>
+#include <assets/shaders/box_vert.h>
+#include <assets/shaders/box_frag.h>
+#include <assets/shaders/instance_vert.h>
+#include <assets/shaders/sky_vert.h>
+#include <assets/shaders/sky_frag.h>
 #include <assets/textures/grass.h>
 #include <assets/textures/dirt.h>
 #include <assets/textures/grass_side.h>
+#include <assets/textures/lamp.h>
+#include <assets/textures/glass.h>
+#include <assets/textures/water.h>
+#include <assets/block_table.h>
 
 #include <string.h>
+#include <time.h>
 #include <cglm/cglm.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-char* len_to_cstr(unsigned char* str, unsigned int len) {
-    unsigned char* new = malloc(len + 1);
-    if (!new) return NULL;
-    memcpy(new, str, len);
-    new[len] = '\0';
-    return (char*) new;
-}
-
-GLuint compile_shader(const char* source, GLenum type) {
+#include "world.h"
+#include "raycast.h"
+#include "physics.h"
+#include "culling.h"
+#include "light.h"
+#include "jobs.h"
+#include "startup.h"
+#include "pacing.h"
+#include "debris.h"
+
+// defines, if not NULL, are inserted after the #version line so one source can be compiled into variants
+GLuint compile_shader(const char* source, GLenum type, const char* defines) {
     GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
+    const char* version_end = defines ? strchr(source, '\n') : NULL;
+    if (version_end) {
+        const char* sources[3] = { source, defines, version_end + 1 };
+        GLint lengths[3] = { (GLint)(version_end + 1 - source), -1, -1 };
+        glShaderSource(shader, 3, sources, lengths);
+    } else {
+        glShaderSource(shader, 1, &source, NULL);
+    }
     glCompileShader(shader);
 
     GLint success;
@@ -44,25 +64,29 @@ GLuint compile_shader(const char* source, GLenum type) {
     return shader;
 }
 
-GLuint create_shader_program(const char* vert_src, const char* frag_src, const char* geo_shader) {
-    GLuint vertex = compile_shader(vert_src, GL_VERTEX_SHADER);
+GLuint create_shader_program(const char* vert_src, const char* frag_src, const char* geo_shader, const char* defines) {
+    GLuint vertex = compile_shader(vert_src, GL_VERTEX_SHADER, defines);
     if (vertex == 0) return 0;
-    GLuint fragment = compile_shader(frag_src, GL_FRAGMENT_SHADER);
+    GLuint fragment = compile_shader(frag_src, GL_FRAGMENT_SHADER, defines);
     if (fragment == 0) {
         glDeleteShader(vertex);
         return 0;
     }
-    GLuint geo = compile_shader(geo_shader, GL_GEOMETRY_SHADER);
-    if (geo == 0) {
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        return 0;
+    // geo_shader is optional, deleting shader 0 is a no op
+    GLuint geo = 0;
+    if (geo_shader) {
+        geo = compile_shader(geo_shader, GL_GEOMETRY_SHADER, defines);
+        if (geo == 0) {
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+            return 0;
+        }
     }
 
     GLuint program = glCreateProgram();
     glAttachShader(program, vertex);
     glAttachShader(program, fragment);
-    glAttachShader(program, geo);
+    if (geo) glAttachShader(program, geo);
     glLinkProgram(program);
 
     GLint success;
@@ -85,7 +109,13 @@ GLuint create_shader_program(const char* vert_src, const char* frag_src, const c
 }
 
 int WIDTH, HEIGHT;
-vec3 pos = {0, 0, 0};
+World* world;
+LightEngine light_engine;
+RayHit looking_at; // block under the crosshair
+vec3 pos = {0, 0, 0}; // eye position, follows player
+Body player = { .half_extents = {0.3f, 0.9f, 0.3f} };
+Debris debris; // pieces of broken blocks, drawn as instances
+double last_update = 0;
 float yaw = -90.0f; // Start facing -Z
 float pitch = 0.0f;
 float lastX;
@@ -94,7 +124,26 @@ bool firstMouse = true;
 vec3 front = {0.0f, 0.0f, -1.0f};
 vec3 up = {0.0f, 1.0f, 0.0f};
 
+FramePacer pacer;
+// latency measurement, toggled with L, input events are tagged with the time they were handled and the frame
+// that picks them up records how long it took from there to its swap
+bool measure_latency = false;
+double input_time = 0; // first tagged event not in a frame yet, 0 if none
+LatencyStats input_latency;
+LatencyStats sample_latency;
+
+void tag_input() {
+    if (measure_latency && input_time == 0) input_time = now_seconds();
+}
+
+void set_pacing(PacingMode mode) {
+    pacer.mode = mode;
+    pacer.deadline = 0;
+    glfwSwapInterval(mode == PACING_VSYNC ? 1 : 0);
+}
+
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
+    tag_input();
     if (firstMouse) {
         lastX = xpos;
         lastY = ypos;
@@ -125,9 +174,103 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 
+BlockId selected_block = BLOCK_COBBLED_STONE;
+// clicks since the last update, edits are applied there so they land in one remesh
+bool break_pressed = false;
+bool place_pressed = false;
+bool occlusion_culling = true; // gpu occlusion queries on top of cpu culling, toggled with O
+bool binary_meshing = true; // full detail chunks through mesh_chunk_binary instead of mesh_chunk, toggled with B
+// opaque faces are drawn to depth alone first and shaded only where they ended up in front, toggled with Z
+bool depth_prepass = false;
+// the opaque and cutout passes walk the visible list farthest first, only --draw-bench's baseline sets it
+bool solid_back_to_front = false;
+
+// programs of the chunk passes, the cutout one is compiled with ALPHA_TEST and discards see-through texels,
+// translucent faces are drawn with the opaque one and blending on, the depth one is compiled with DEPTH_ONLY for
+// the pre-pass
+struct {
+    GLuint opaque;
+    GLuint cutout;
+    GLuint depth;
+} Chunk_Programs;
+
+// full screen pass of the sky color, the triangle comes from gl_VertexID but core profile still wants a VAO bound
+struct {
+    GLuint program;
+    GLuint VAO; // no attributes
+} Sky;
+
+// dynamic block shaped objects like debris are drawn as instances of one cube instead of being meshed into chunks
+// instances are written every frame into a mapped region of a streaming buffer, the buffer holds INSTANCE_FRAMES
+// regions used in turn and a region is only written again once the fence after its last draw has passed, so the
+// mapping can skip synchronizing with the gpu
+typedef struct {
+    vec3 position; // center
+    float scale;   // edge length, 1 for a whole block
+    float yaw;     // rotation around y in radians
+    float light;   // brightness
+    uint32_t block;
+} BlockInstance;
+
+#define INSTANCE_CAPACITY 65536 // per frame, more are dropped
+#define INSTANCE_FRAMES 3
+#define INSTANCE_FENCE_TIMEOUT 1000000000 // ns, a region still in use after a second is written anyway
+#define INSTANCE_FACE_UNIT 1 // texture unit of the face texture buffer, the atlas is on 0
+
+struct {
+    GLuint program;
+    GLuint VAO, VBO, EBO; // unit cube, 4 corners per face
+    GLuint instance_buffer;
+    GLuint face_buffer, face_texture; // Blocks.face_textures as a texture buffer
+    GLsync fences[INSTANCE_FRAMES];
+    int region;
+    BlockInstance* mapped; // region being written this frame, NULL outside begin_instances and draw_instances
+    size_t count;
+} Instances;
+
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode) {
+    tag_input();
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
+    if (key == GLFW_KEY_1 && action == GLFW_PRESS) selected_block = BLOCK_GRASS;
+    if (key == GLFW_KEY_2 && action == GLFW_PRESS) selected_block = BLOCK_DIRT;
+    if (key == GLFW_KEY_3 && action == GLFW_PRESS) selected_block = BLOCK_COBBLED_STONE;
+    if (key == GLFW_KEY_4 && action == GLFW_PRESS) selected_block = BLOCK_LAMP;
+    if (key == GLFW_KEY_5 && action == GLFW_PRESS) selected_block = BLOCK_GLASS;
+    if (key == GLFW_KEY_6 && action == GLFW_PRESS) selected_block = BLOCK_WATER;
+    if (key == GLFW_KEY_O && action == GLFW_PRESS) occlusion_culling = !occlusion_culling;
+    if (key == GLFW_KEY_Z && action == GLFW_PRESS) {
+        depth_prepass = !depth_prepass;
+        printf("depth pre-pass: %s\n", depth_prepass ? "on" : "off");
+    }
+    if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        binary_meshing = !binary_meshing;
+        world_mark_all_dirty(world);
+    }
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        set_pacing((pacer.mode + 1) % PACING_MODE_COUNT);
+        printf("pacing: %s\n", PACING_MODE_NAMES[pacer.mode]);
+    }
+    if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        measure_latency = !measure_latency;
+        input_time = 0;
+        if (!measure_latency) {
+            latency_report(stdout, "input to swap", &input_latency);
+            latency_report(stdout, "sample to swap", &sample_latency);
+        }
+    }
+    if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        mem_report(stdout);
+        printf("scratch: %.1f of %d kb high water\n", scratch_arena()->high_water / 1024.0, SCRATCH_SIZE / 1024);
+        printf("chunks: %zu unpacked, %.1f kb packed\n", world->hot_count, world->packed_bytes / 1024.0);
+    }
+}
+
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    tag_input();
+    if (action != GLFW_PRESS) return;
+    if (button == GLFW_MOUSE_BUTTON_LEFT) break_pressed = true;
+    if (button == GLFW_MOUSE_BUTTON_RIGHT) place_pressed = true;
 }
 
 bool isKeyHeld(GLFWwindow* window, int key) {
@@ -136,6 +279,23 @@ bool isKeyHeld(GLFWwindow* window, int key) {
 }
 
 #define SPEED 0.1f
+#define REACH 8.0f
+#define EYE_OFFSET 0.72f // eyes 1.62 above the feet of the 1.8 tall player box
+
+// gameplay edit, waits for the light thread to let go of the world and queues the relight,
+// returns the light of the block next to it across face (the block itself for FACE_NONE) read under the same lock
+uint8_t edit_block(int x, int y, int z, BlockId id, int face) {
+    int lit[3] = { x, y, z };
+    for (int a = 0; a < 3 && face != FACE_NONE; a++) lit[a] += FACE_NORMALS[face][a];
+    pthread_mutex_lock(&light_engine.world_lock);
+    BlockId old_id = world_get_block(world, x, y, z);
+    if (world_edit_block(world, x, y, z, id)) {
+        light_engine_edit(&light_engine, x, y, z, old_id);
+    }
+    uint8_t light = world_get_light(world, lit[0], lit[1], lit[2]);
+    pthread_mutex_unlock(&light_engine.world_lock);
+    return light;
+}
 
 void update(GLFWwindow* window) {
     vec3 move = {0, 0, 0};
@@ -155,7 +315,32 @@ void update(GLFWwindow* window) {
     glm_vec3_scale(move, SPEED, move);
     if (isKeyHeld(window, GLFW_KEY_SPACE)) move[1]+=SPEED; 
     if (isKeyHeld(window, GLFW_KEY_LEFT_SHIFT)) move[1]-=SPEED;
-    glm_vec3_add(pos, move, pos);
+    physics_move(world, &player, move);
+    glm_vec3_copy(player.center, pos);
+    pos[1] += EYE_OFFSET;
+    looking_at = raycast(world, pos, front, REACH);
+
+    double now = now_seconds();
+    debris_step(&debris, world, last_update ? (float)(now - last_update) : 0.0f);
+    last_update = now;
+
+    if (break_pressed && looking_at.hit) {
+        const int* block = looking_at.block;
+        // lit like the face that was broken until the pieces are sampled with the rest of the frame's light reads
+        uint8_t light = edit_block(block[0], block[1], block[2], BLOCK_AIR, looking_at.face);
+        debris_burst(&debris, looking_at.id, block[0], block[1], block[2], light_brightness(light));
+    }
+    if (place_pressed && looking_at.hit && looking_at.face != FACE_NONE) {
+        const int* normal = FACE_NORMALS[looking_at.face];
+        int x = looking_at.block[0] + normal[0];
+        int y = looking_at.block[1] + normal[1];
+        int z = looking_at.block[2] + normal[2];
+        if (!body_intersects_block(&player, x, y, z)) {
+            edit_block(x, y, z, selected_block, FACE_NONE);
+        }
+    }
+    break_pressed = false;
+    place_pressed = false;
 }
 
 void set_size(int width, int height) {
@@ -168,7 +353,14 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     set_size(width, height);
     GLint currentProgram;
     glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-    glUniform2f(glGetUniformLocation(currentProgram, "screenSize"), (float)WIDTH, (float)HEIGHT);
+    // the chunk programs, the instance program and the sky draw the crosshair
+    GLuint programs[4] = { Chunk_Programs.opaque, Chunk_Programs.cutout, Instances.program, Sky.program };
+    for (int i = 0; i < 4; i++) {
+        if (!programs[i]) continue;
+        glUseProgram(programs[i]);
+        glUniform2f(glGetUniformLocation(programs[i], "screenSize"), (float)WIDTH, (float)HEIGHT);
+    }
+    glUseProgram(currentProgram);
 }
 
 
@@ -180,292 +372,1795 @@ typedef struct {
     unsigned char* data;
     int width;
     int height;
-    int channels;  // keep channels per image in case it varies (or assume all same)
+    int x, y; // top left corner in the atlas
     UV* uv;
 } Img;
 
-
-unsigned char* generate_texture_atlas_struct(
-    Img* images,
-    int count,
-    int channels,         // assume all images have this channels count
-    int* out_width,
-    int* out_height,
-    int* out_channels
-    ) {
+// simple grid packing, no fancy bin-packing, from the image sizes alone so images can be copied in as they're decoded
+// sets x, y and uv of every image
+bool layout_texture_atlas(Img* images, int count, int* out_width, int* out_height) {
     int images_per_row = (int)ceilf(sqrtf(count));
+    if (!images || count <= 0 || images_per_row <= 0) return false;
 
-    if (!images || count <= 0 || channels <= 0 || images_per_row <= 0) return NULL;
-
-    // Calculate max width and height per row to handle varying sizes
     int atlas_width = 0;
     int atlas_height = 0;
+    for (int row = 0; row * images_per_row < count; row++) {
+        // widest row and tallest image of each row
+        int row_width = 0, row_height = 0;
+        for (int i = row * images_per_row; i < count && i < (row + 1) * images_per_row; i++) {
+            images[i].x = row_width;
+            images[i].y = atlas_height;
+            row_width += images[i].width;
+            if (images[i].height > row_height) row_height = images[i].height;
+        }
+        if (row_width > atlas_width) atlas_width = row_width;
+        atlas_height += row_height;
+    }
 
-    int row_width = 0;
-    int row_height = 0;
+    for (int i = 0; i < count; i++) {
+        Img* img = &images[i];
+        if (!img->uv) continue;
+        img->uv->umin = (float)img->x / atlas_width;
+        img->uv->umax = (float)(img->x + img->width) / atlas_width;
+        img->uv->vmin = (float)(img->y + img->height) / atlas_height; // OpenGL UV origin = bottom left
+        img->uv->vmax = (float)img->y / atlas_height;
+    }
+    *out_width = atlas_width;
+    *out_height = atlas_height;
+    return true;
+}
 
-    // Pre-calc atlas size (simple grid packing, no fancy bin-packing)
-    int rows = (count + images_per_row - 1) / images_per_row;
-    int* row_heights = malloc(rows * sizeof(int));
-    if (!row_heights) return NULL;
+void blit_texture(unsigned char* atlas, int atlas_width, int channels, const Img* img) {
+    for (int y = 0; y < img->height; y++) {
+        unsigned char* dst = atlas + ((img->y + y) * atlas_width + img->x) * channels;
+        unsigned char* src = img->data + y * img->width * channels;
+        memcpy(dst, src, img->width * channels);
+    }
+}
 
-    for (int r = 0; r < rows; r++) row_heights[r] = 0;
+// every texture in the atlas, block_table.txt refers to them by name
+#define TEXTURE_COUNT 7
+const char* const TEXTURE_NAMES[TEXTURE_COUNT] = { "cobbled_stone", "grass", "dirt", "grass_side", "lamp", "glass", "water" };
+UV Texture_UVs[TEXTURE_COUNT]; // filled in by start_atlas_load
 
-    // Track widths & heights of each row
-    for (int i = 0; i < count; i++) {
-        int col = i % images_per_row;
-        int row = i / images_per_row;
+bool init_blocks() {
+    return load_blocks(&Blocks, (const char*)assets_block_table_txt_start, TEXTURE_NAMES, TEXTURE_COUNT);
+}
 
-        row_width += images[i].width;
-        if (images[i].height > row_heights[row]) {
-            row_heights[row] = images[i].height;
+// the atlas is laid out from the png headers, then every texture is decoded on the job pool and copied into
+// its place as soon as it's done, while the caller goes on with other startup work
+typedef struct AtlasLoad {
+    Img images[TEXTURE_COUNT];
+    const unsigned char* files[TEXTURE_COUNT];
+    int lengths[TEXTURE_COUNT];
+    struct AtlasJob {
+        struct AtlasLoad* load;
+        int index;
+    } jobs[TEXTURE_COUNT];
+    unsigned char* atlas;
+    int width, height, channels;
+    JobGroup group;
+    atomic_bool failed;
+} AtlasLoad;
+
+void decode_texture_job(void* arg) {
+    double start = now_seconds();
+    struct AtlasJob* job = arg;
+    AtlasLoad* load = job->load;
+    Img img = load->images[job->index];
+    int width, height, channels;
+    img.data = stbi_load_from_memory(load->files[job->index], load->lengths[job->index], &width, &height, &channels, load->channels);
+    if (!img.data) {
+        fprintf(stderr, "Failed to decode texture %s: %s\n", TEXTURE_NAMES[job->index], stbi_failure_reason());
+        atomic_store(&load->failed, true);
+        return;
+    }
+    // stbi allocates the pixels itself, they're counted from here until stbi_image_free
+    size_t bytes = (size_t)width * height * load->channels;
+    mem_track_alloc(MEM_TEXTURES, bytes);
+    bool resized = width != img.width || height != img.height;
+    if (!resized) blit_texture(load->atlas, load->width, load->channels, &img);
+    mem_track_free(MEM_TEXTURES, bytes);
+    stbi_image_free(img.data);
+    if (resized) {
+        fprintf(stderr, "Failed to decode texture %s: size changed\n", TEXTURE_NAMES[job->index]);
+        atomic_store(&load->failed, true);
+        return;
+    }
+    char phase[32];
+    snprintf(phase, sizeof(phase), "decode %s", TEXTURE_NAMES[job->index]);
+    startup_phase(phase, start);
+}
+
+bool start_atlas_load(AtlasLoad* load, JobPool* pool, int desired) {
+    *load = (AtlasLoad){
+        .files = {
+            assets_textures_cobbled_stone_png_start,
+            assets_textures_grass_png_start,
+            assets_textures_dirt_png_start,
+            assets_textures_grass_side_png_start,
+            assets_textures_lamp_png_start,
+            assets_textures_glass_png_start,
+            assets_textures_water_png_start,
+        },
+        .lengths = {
+            assets_textures_cobbled_stone_png_len,
+            assets_textures_grass_png_len,
+            assets_textures_dirt_png_len,
+            assets_textures_grass_side_png_len,
+            assets_textures_lamp_png_len,
+            assets_textures_glass_png_len,
+            assets_textures_water_png_len,
+        },
+        .channels = desired,
+    };
+    for (int i = 0; i < TEXTURE_COUNT; i++) {
+        int channels;
+        if (!stbi_info_from_memory(load->files[i], load->lengths[i], &load->images[i].width, &load->images[i].height, &channels)) {
+            fprintf(stderr, "Failed to read the header of texture %s: %s\n", TEXTURE_NAMES[i], stbi_failure_reason());
+            return false;
         }
+        load->images[i].uv = &Texture_UVs[i];
+    }
+    if (!layout_texture_atlas(load->images, TEXTURE_COUNT, &load->width, &load->height)) return false;
+    // gaps between images of different sizes stay transparent
+    load->atlas = mem_calloc(MEM_TEXTURES, (size_t)load->width * load->height, desired);
+    if (!load->atlas) return false;
+    for (int i = 0; i < TEXTURE_COUNT; i++) {
+        load->jobs[i] = (struct AtlasJob){ load, i };
+        job_submit(pool, decode_texture_job, &load->jobs[i], &load->group);
+    }
+    return true;
+}
+
+// waits for the decodes, the atlas is freed with mem_free(MEM_TEXTURES, atlas, width * height * channels)
+unsigned char* finish_atlas_load(AtlasLoad* load, JobPool* pool, int* out_width, int* out_height, int* out_channels) {
+    job_group_wait(pool, &load->group);
+    if (atomic_load(&load->failed)) {
+        mem_free(MEM_TEXTURES, load->atlas, (size_t)load->width * load->height * load->channels);
+        return NULL;
+    }
+    *out_width = load->width;
+    *out_height = load->height;
+    *out_channels = load->channels;
+    return load->atlas;
+}
+
+unsigned char* get_atlas(JobPool* pool, int* out_width, int* out_height, int* out_channels, int desired) {
+    AtlasLoad load;
+    if (!start_atlas_load(&load, pool, desired)) return NULL;
+    return finish_atlas_load(&load, pool, out_width, out_height, out_channels);
+}
+
+// faces of each render layer are indexed separately, the vertices are shared
+// uploaded one layer after the other into one index buffer so a pass draws a single range of it
+#define MESH_LAYER_COUNT 3 // RenderLayer without RENDER_LAYER_NONE
+#define MESH_LAYER(id) (Blocks.render_layer[id] - RENDER_LAYER_OPAQUE)
+#define MESH_LAYER_OPAQUE (RENDER_LAYER_OPAQUE - RENDER_LAYER_OPAQUE)
+#define MESH_LAYER_CUTOUT (RENDER_LAYER_CUTOUT - RENDER_LAYER_OPAQUE)
+#define MESH_LAYER_TRANSLUCENT (RENDER_LAYER_TRANSLUCENT - RENDER_LAYER_OPAQUE)
+
+typedef struct {
+    float* vertices;
+    size_t vertices_len;
+    size_t vertices_limit;
+    unsigned int* indices[MESH_LAYER_COUNT];
+    size_t indices_len[MESH_LAYER_COUNT];
+    size_t indices_limit[MESH_LAYER_COUNT];
+} MeshBuffer;
+
+// staging space reserved up front, the busiest chunk of the generated terrain takes two thirds of it through mesh_chunk
+// so remeshing doesn't grow the buffer while streaming chunks in
+#define MESH_STAGING_FLOATS (1 << 17)
+#define MESH_STAGING_INDICES (MESH_STAGING_FLOATS / 4)
+
+// indices is the size of the opaque layer, cutout and translucent faces are rare and start with an eighth of it
+MeshBuffer new_MeshBuffer_sized(size_t floats, size_t indices) {
+    MeshBuffer buffer = {
+        .vertices = mem_malloc(MEM_MESHES, sizeof(float) * floats),
+        .vertices_limit=floats,
+        .vertices_len=0,
+    };
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        size_t limit = layer == 0 ? indices : indices / 8;
+        buffer.indices[layer] = mem_malloc(MEM_MESHES, sizeof(int) * limit);
+        buffer.indices_limit[layer] = limit;
+        buffer.indices_len[layer] = 0;
+    }
+    return buffer;
+}
 
-        if (col == images_per_row - 1 || i == count -1) {
-            if (row_width > atlas_width) atlas_width = row_width;
-            row_width = 0;
+MeshBuffer new_MeshBuffer() {
+    return new_MeshBuffer_sized(MESH_STAGING_FLOATS, MESH_STAGING_INDICES);
+}
+void push_vert(MeshBuffer* buffer, float vert) {
+    if(buffer->vertices_limit <= buffer->vertices_len) {
+        buffer->vertices_limit*=2;
+        buffer->vertices = mem_realloc(MEM_MESHES, buffer->vertices, sizeof(float) * buffer->vertices_limit / 2, sizeof(float) * buffer->vertices_limit);
+    }
+    buffer->vertices[buffer->vertices_len] = vert;
+    buffer->vertices_len++;
+}
+void push_index(MeshBuffer* buffer, int layer, unsigned int index) {
+    if(buffer->indices_limit[layer] <= buffer->indices_len[layer]) {
+        buffer->indices_limit[layer]*=2;
+        buffer->indices[layer] = mem_realloc(MEM_MESHES, buffer->indices[layer], sizeof(int) * buffer->indices_limit[layer] / 2, sizeof(int) * buffer->indices_limit[layer]);
+    }
+    buffer->indices[layer][buffer->indices_len[layer]] = index;
+    buffer->indices_len[layer]++;
+}
+
+size_t mesh_index_count(MeshBuffer* buffer) {
+    size_t count = 0;
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) count += buffer->indices_len[layer];
+    return count;
+}
+
+// corner offsets of each face in Face order, last two pick umax/vmax over umin/vmin
+const float FACE_CORNERS[6][4][5] = {
+    { { 0.5f,  0.5f, -0.5f, 1, 1 }, { 0.5f, -0.5f, -0.5f, 1, 0 }, { 0.5f, -0.5f,  0.5f, 0, 0 }, { 0.5f,  0.5f,  0.5f, 0, 1 } },
+    { {-0.5f,  0.5f,  0.5f, 1, 1 }, {-0.5f, -0.5f,  0.5f, 1, 0 }, {-0.5f, -0.5f, -0.5f, 0, 0 }, {-0.5f,  0.5f, -0.5f, 0, 1 } },
+    { {-0.5f,  0.5f,  0.5f, 0, 1 }, { 0.5f,  0.5f,  0.5f, 1, 1 }, { 0.5f,  0.5f, -0.5f, 1, 0 }, {-0.5f,  0.5f, -0.5f, 0, 0 } },
+    { {-0.5f, -0.5f, -0.5f, 0, 1 }, { 0.5f, -0.5f, -0.5f, 1, 1 }, { 0.5f, -0.5f,  0.5f, 1, 0 }, {-0.5f, -0.5f,  0.5f, 0, 0 } },
+    { { 0.5f,  0.5f,  0.5f, 1, 1 }, { 0.5f, -0.5f,  0.5f, 1, 0 }, {-0.5f, -0.5f,  0.5f, 0, 0 }, {-0.5f,  0.5f,  0.5f, 0, 1 } },
+    { {-0.5f,  0.5f, -0.5f, 1, 1 }, {-0.5f, -0.5f, -0.5f, 1, 0 }, { 0.5f, -0.5f, -0.5f, 0, 0 }, { 0.5f,  0.5f, -0.5f, 0, 1 } },
+};
+const unsigned int FACE_INDICES[6][6] = {
+    { 2, 1, 0, 3, 2, 0 },
+    { 2, 1, 0, 3, 2, 0 },
+    { 0, 1, 2, 0, 2, 3 },
+    { 0, 1, 2, 0, 2, 3 },
+    { 2, 1, 0, 3, 2, 0 },
+    { 2, 1, 0, 3, 2, 0 },
+};
+
+// position, uv, brightness and texture, uv counts repeats of the texture and the shader wraps it into its atlas tile
+#define VERTEX_FLOATS 7
+// length of the tiles uniform in vert.glsl and instance_vert.glsl
+#define MAX_TILES 64
+_Static_assert(TEXTURE_COUNT <= MAX_TILES, "more textures than the tiles uniform holds, raise MAX_TILES and the shaders");
+
+// world axes the texture's u and v run along on each face, in FACE_CORNERS orientation
+const int FACE_UV_AXES[6][2] = { { 2, 1 }, { 2, 1 }, { 0, 2 }, { 0, 2 }, { 0, 1 }, { 0, 1 } };
+
+// ambient occlusion of a face corner, 0 when both blocks next to it are solid and 3 when none of the three are
+const float AO_BRIGHTNESS[4] = { 0.5f, 0.7f, 0.85f, 1.0f };
+
+// face of a size blocks wide cube centered on pos, the texture is stretched over the whole face
+// light is the packed light of the block in front of the face, ao is per corner in FACE_CORNERS order or NULL
+void createScaledFace(MeshBuffer* buffer, BlockId id, vec3 pos, float size, Face face, uint8_t light, const uint8_t* ao) {
+    float tile = Blocks.face_textures[id][face];
+    float brightness = light_brightness(light);
+    int layer = MESH_LAYER(id);
+    size_t prelen = buffer->vertices_len/VERTEX_FLOATS;
+    for(int i = 0; i < 4; i++) {
+        const float* corner = FACE_CORNERS[face][i];
+        push_vert(buffer, pos[0] + corner[0] * size);
+        push_vert(buffer, pos[1] + corner[1] * size);
+        push_vert(buffer, pos[2] + corner[2] * size);
+        push_vert(buffer, corner[3]);
+        push_vert(buffer, corner[4]);
+        push_vert(buffer, ao ? brightness * AO_BRIGHTNESS[ao[i]] : brightness);
+        push_vert(buffer, tile);
+    }
+    // split the quad along the diagonal with the brighter ends, otherwise the darkening is interpolated unevenly
+    int rotate = ao && ao[0] + ao[2] < ao[1] + ao[3];
+    for(int i = 0; i < 6; i++) {
+        push_index(buffer, layer, prelen + (FACE_INDICES[face][i] + rotate) % 4);
+    }
+}
+
+void createFace(MeshBuffer* buffer, BlockId id, vec3 pos, Face face, uint8_t light, const uint8_t* ao) {
+    createScaledFace(buffer, id, pos, 1.0f, face, light, ao);
+}
+
+// face of a box of blocks, min is its lowest block and size its extent in blocks with 1 along the face's axis
+// unlike createScaledFace the texture repeats once per block
+void createQuad(MeshBuffer* buffer, BlockId id, const int min[3], const int size[3], Face face, uint8_t light, const uint8_t* ao) {
+    float tile = Blocks.face_textures[id][face];
+    float brightness = light_brightness(light);
+    int layer = MESH_LAYER(id);
+    size_t prelen = buffer->vertices_len/VERTEX_FLOATS;
+    for(int i = 0; i < 4; i++) {
+        const float* corner = FACE_CORNERS[face][i];
+        for(int a = 0; a < 3; a++) {
+            push_vert(buffer, corner[a] > 0.0f ? min[a] + size[a] - 0.5f : min[a] - 0.5f);
         }
+        push_vert(buffer, corner[3] * size[FACE_UV_AXES[face][0]]);
+        push_vert(buffer, corner[4] * size[FACE_UV_AXES[face][1]]);
+        push_vert(buffer, ao ? brightness * AO_BRIGHTNESS[ao[i]] : brightness);
+        push_vert(buffer, tile);
+    }
+    int rotate = ao && ao[0] + ao[2] < ao[1] + ao[3];
+    for(int i = 0; i < 6; i++) {
+        push_index(buffer, layer, prelen + (FACE_INDICES[face][i] + rotate) % 4);
     }
+}
 
-    for (int r = 0; r < rows; r++) {
-        atlas_height += row_heights[r];
+void createBlock(MeshBuffer* buffer, BlockId id, vec3 pos) {
+    for(int face = 0; face < 6; face++) {
+        createFace(buffer, id, pos, face, LIGHT_EMPTY_CHUNK, NULL);
     }
+}
 
-    unsigned char* atlas = malloc(atlas_width * atlas_height * channels);
-    if (!atlas) {
-        free(row_heights);
-        return NULL;
+// brick of opaque blocks surrounded by bricks of opaque blocks inside the same chunk, none of its faces can be visible,
+// glass or water still show the faces behind them so only opacity counts here
+bool brick_buried(Chunk* chunk, int bx, int by, int bz) {
+    if (chunk->brick_opaque[BRICK_INDEX(bx, by, bz)] != BRICK_FULL) return false;
+    for (int face = 0; face < 6; face++) {
+        int nx = bx + FACE_NORMALS[face][0];
+        int ny = by + FACE_NORMALS[face][1];
+        int nz = bz + FACE_NORMALS[face][2];
+        if ((unsigned)nx >= CHUNK_BRICKS || (unsigned)ny >= CHUNK_BRICKS || (unsigned)nz >= CHUNK_BRICKS) return false;
+        if (chunk->brick_opaque[BRICK_INDEX(nx, ny, nz)] != BRICK_FULL) return false;
     }
-    memset(atlas, 0, atlas_width * atlas_height * channels);
+    return true;
+}
 
-    int y_offset = 0;
-    for (int r = 0; r < rows; r++) {
-        int x_offset = 0;
-        for (int c = 0; c < images_per_row; c++) {
-            int i = r * images_per_row + c;
-            if (i >= count) break;
+// copy of a chunk's blocks and light with a one block border taken from its neighbors,
+// so meshing never has to look outside of it
+#define PADDED_SIZE (CHUNK_SIZE + 2)
+#define PADDED_VOLUME (PADDED_SIZE * PADDED_SIZE * PADDED_SIZE)
+// local coordinates from -1 to CHUNK_SIZE
+#define PADDED_INDEX(x, y, z) ((((y) + 1) * PADDED_SIZE + (z) + 1) * PADDED_SIZE + (x) + 1)
 
-            Img* img = &images[i];
-            for (int y = 0; y < img->height; y++) {
-                unsigned char* dst = atlas + ((y_offset + y) * atlas_width + x_offset) * channels;
-                unsigned char* src = img->data + y * img->width * channels;
-                memcpy(dst, src, img->width * channels);
+typedef struct {
+    BlockId* blocks;
+    uint8_t* light;
+} PaddedChunk;
+
+// the arrays are taken from arena
+PaddedChunk pad_chunk(Arena* arena, World* world, Chunk* chunk) {
+    PaddedChunk padded = {
+        .blocks = arena_alloc(arena, sizeof(BlockId) * PADDED_VOLUME),
+        .light = arena_alloc(arena, PADDED_VOLUME),
+    };
+    // the chunk and its 26 neighbors, looked up once instead of for every border block
+    Chunk* around[3][3][3];
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                around[dy + 1][dz + 1][dx + 1] = world_get_chunk(world, chunk->cx + dx, chunk->cy + dy, chunk->cz + dz);
             }
-            if (img->uv) {
-                img->uv->umin = (float)x_offset / atlas_width;
-                img->uv->umax = (float)(x_offset + img->width) / atlas_width;
-                img->uv->vmin = (float)(y_offset + img->height) / atlas_height; // OpenGL UV origin = bottom left
-                img->uv->vmax = (float)(y_offset) / atlas_height;
+        }
+    }
+    for (int y = -1; y <= CHUNK_SIZE; y++) {
+        for (int z = -1; z <= CHUNK_SIZE; z++) {
+            int row = PADDED_INDEX(0, y, z);
+            int ny = (y >= 0) + (y >= CHUNK_SIZE), nz = (z >= 0) + (z >= CHUNK_SIZE);
+            int local = CHUNK_INDEX(0, BLOCK_TO_LOCAL(y), BLOCK_TO_LOCAL(z));
+            for (int nx = 0; nx < 3; nx++) {
+                // -1, 0..CHUNK_SIZE-1 and CHUNK_SIZE along x come from the three chunks in this row
+                int x0 = nx == 0 ? -1 : nx == 1 ? 0 : CHUNK_SIZE;
+                int count = nx == 1 ? CHUNK_SIZE : 1;
+                Chunk* source = around[ny][nz][nx];
+                if (source) {
+                    memcpy(padded.blocks + row + x0, source->blocks + local + BLOCK_TO_LOCAL(x0), sizeof(BlockId) * count);
+                    memcpy(padded.light + row + x0, source->light + local + BLOCK_TO_LOCAL(x0), count);
+                } else {
+                    memset(padded.blocks + row + x0, BLOCK_AIR, sizeof(BlockId) * count);
+                    memset(padded.light + row + x0, LIGHT_EMPTY_CHUNK, count);
+                }
             }
-            x_offset += img->width;
         }
-        y_offset += row_heights[r];
     }
+    return padded;
+}
 
-    free(row_heights);
+// ambient occlusion of each corner of a face from the two side and one diagonal block in front of it
+void face_ao(const PaddedChunk* padded, int x, int y, int z, Face face, uint8_t ao[4]) {
+    int axis = face / 2, u = (axis + 1) % 3, v = (axis + 2) % 3;
+    int front[3] = { x + FACE_NORMALS[face][0], y + FACE_NORMALS[face][1], z + FACE_NORMALS[face][2] };
+    for (int i = 0; i < 4; i++) {
+        int du = FACE_CORNERS[face][i][u] > 0.0f ? 1 : -1;
+        int dv = FACE_CORNERS[face][i][v] > 0.0f ? 1 : -1;
+        int p[3] = { front[0], front[1], front[2] };
+        p[u] += du;
+        bool side_u = block_opaque(padded->blocks[PADDED_INDEX(p[0], p[1], p[2])]);
+        p[v] += dv;
+        bool diagonal = block_opaque(padded->blocks[PADDED_INDEX(p[0], p[1], p[2])]);
+        p[u] -= du;
+        bool side_v = block_opaque(padded->blocks[PADDED_INDEX(p[0], p[1], p[2])]);
+        ao[i] = side_u && side_v ? 0 : 3 - side_u - side_v - diagonal;
+    }
+}
 
-    *out_width = atlas_width;
-    *out_height = atlas_height;
-    *out_channels = channels;
+// faces of the chunk that aren't covered by a neighboring block, neighbors in other chunks included
+void mesh_chunk(MeshBuffer* buffer, World* world, Chunk* chunk) {
+    int base_x = chunk->cx * CHUNK_SIZE;
+    int base_y = chunk->cy * CHUNK_SIZE;
+    int base_z = chunk->cz * CHUNK_SIZE;
+    Arena* arena = scratch_arena();
+    size_t mark = arena->used;
+    PaddedChunk padded = pad_chunk(arena, world, chunk);
+    for (int by = 0; by < CHUNK_BRICKS; by++) {
+        for (int bz = 0; bz < CHUNK_BRICKS; bz++) {
+            for (int bx = 0; bx < CHUNK_BRICKS; bx++) {
+                if (!chunk_brick_occupied(chunk, BRICK_INDEX(bx, by, bz))) continue;
+                if (brick_buried(chunk, bx, by, bz)) continue;
+                for (int y = by * BRICK_SIZE; y < (by + 1) * BRICK_SIZE; y++) {
+                    for (int z = bz * BRICK_SIZE; z < (bz + 1) * BRICK_SIZE; z++) {
+                        for (int x = bx * BRICK_SIZE; x < (bx + 1) * BRICK_SIZE; x++) {
+                            BlockId id = chunk->blocks[CHUNK_INDEX(x, y, z)];
+                            if (Blocks.render_layer[id] == RENDER_LAYER_NONE) continue;
+                            for (int face = 0; face < 6; face++) {
+                                int neighbor = PADDED_INDEX(x + FACE_NORMALS[face][0], y + FACE_NORMALS[face][1], z + FACE_NORMALS[face][2]);
+                                if (block_face_hidden(id, padded.blocks[neighbor])) continue;
+                                uint8_t ao[4];
+                                face_ao(&padded, x, y, z, face, ao);
+                                createFace(buffer, id, (vec3){ base_x + x, base_y + y, base_z + z }, face, padded.light[neighbor], ao);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    arena_rewind(arena, mark);
+}
 
-    return atlas;
+// index of the lowest set bit, bits can't be 0
+int lowest_bit(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#else
+    return __builtin_ctzll(bits);
+#endif
 }
 
-Img load_image(unsigned char*data, int len, int desired, UV* uv) {
-    int width, height, channels;
-    unsigned char* pixels = stbi_load_from_memory(data, len, &width, &height, &channels, desired);
-    return(Img) {
-        .data=pixels,
-        .height=height,
-        .width=width,
-        .channels=channels,
-        .uv = uv
-    };
+// in place, bit c of row r swaps with bit r of row c
+void transpose64(uint64_t rows[64]) {
+    uint64_t mask = 0x00000000ffffffffull;
+    for (int j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (int k = 0; k < 64; k = (k + j + 1) & ~j) {
+            uint64_t t = (rows[k] >> j ^ rows[k + j]) & mask;
+            rows[k] ^= t << j;
+            rows[k + j] ^= t;
+        }
+    }
+}
+
+// transposes the first PADDED_SIZE rows of a slice of the padded chunk
+// slices with the same row everywhere, all air or all stone underground, are the common case and skip it
+void transpose_slice(uint64_t rows[64]) {
+    uint64_t first = rows[0];
+    bool uniform = true;
+    for (int i = 1; i < PADDED_SIZE && uniform; i++) uniform = rows[i] == first;
+    if (uniform) {
+        uint64_t full = ((uint64_t)1 << PADDED_SIZE) - 1;
+        for (int i = 0; i < PADDED_SIZE; i++) rows[i] = (first >> i) & 1 ? full : 0;
+        return;
+    }
+    memset(rows + PADDED_SIZE, 0, sizeof(uint64_t) * (64 - PADDED_SIZE));
+    transpose64(rows);
+}
+
+// columns of the padded chunk along axis, bit i is padded coordinate i along it
+// b and c are the padded coordinates on the next two axes, (axis + 1) % 3 and (axis + 2) % 3
+#define COLUMN_INDEX(axis, b, c) (((axis) * PADDED_SIZE + (c)) * PADDED_SIZE + (b))
+// merge key of a face that has uneven ambient occlusion and is always emitted alone
+#define FACE_KEY_SINGLE (1u << 18)
+
+// block id, light and ambient occlusion of a face, faces with equal keys look the same and can be merged
+uint32_t face_key(const PaddedChunk* padded, const int p[3], Face face, uint8_t ao[4]) {
+    BlockId id = padded->blocks[PADDED_INDEX(p[0], p[1], p[2])];
+    uint8_t light = padded->light[PADDED_INDEX(p[0] + FACE_NORMALS[face][0], p[1] + FACE_NORMALS[face][1], p[2] + FACE_NORMALS[face][2])];
+    face_ao(padded, p[0], p[1], p[2], face, ao);
+    bool even = ao[0] == ao[1] && ao[0] == ao[2] && ao[0] == ao[3];
+    return id | light << 8 | ao[0] << 16 | (even ? 0 : FACE_KEY_SINGLE);
+}
+
+// same faces as mesh_chunk, found a column at a time instead of block by block
+// opacity is kept as one 64 bit mask per column of the padded chunk along each axis, so a column's exposed faces
+// on the positive side are visible & ~(opaque >> 1), the faces are then sorted into 32 bit rows per layer and
+// neighbors with the same key are merged into rectangles, walking the set bits with bit scans
+void mesh_chunk_binary(MeshBuffer* buffer, World* world, Chunk* chunk) {
+    int base[3] = { chunk->cx * CHUNK_SIZE, chunk->cy * CHUNK_SIZE, chunk->cz * CHUNK_SIZE };
+    Arena* arena = scratch_arena();
+    size_t mark = arena->used;
+    PaddedChunk padded = pad_chunk(arena, world, chunk);
+    size_t column_bytes = sizeof(uint64_t) * 3 * PADDED_SIZE * PADDED_SIZE;
+    uint64_t* opaque = arena_alloc(arena, column_bytes);
+    uint64_t* visible = arena_alloc(arena, column_bytes); // blocks that get faces, only inside the chunk
+    uint32_t* rows = arena_alloc(arena, sizeof(uint32_t) * CHUNK_SIZE * CHUNK_SIZE);
+    uint32_t* keys = arena_alloc(arena, sizeof(uint32_t) * CHUNK_SIZE * CHUNK_SIZE);
+    memset(opaque, 0, column_bytes);
+    memset(visible, 0, column_bytes);
+
+    // x columns straight from the rows of the padded chunk
+    const BlockId* row = padded.blocks;
+    for (int y = 0; y < PADDED_SIZE; y++) {
+        for (int z = 0; z < PADDED_SIZE; z++, row += PADDED_SIZE) {
+            uint64_t o = 0, v = 0;
+            for (int x = 0; x < PADDED_SIZE; x++) {
+                o |= (uint64_t)Blocks.opaque[row[x]] << x;
+                v |= (uint64_t)(Blocks.render_layer[row[x]] != RENDER_LAYER_NONE) << x;
+            }
+            opaque[COLUMN_INDEX(0, y, z)] = o;
+            if (y - 1u < CHUNK_SIZE && z - 1u < CHUNK_SIZE) visible[COLUMN_INDEX(0, y, z)] = v & ((uint64_t)BRICK_FULL >> (64 - CHUNK_SIZE) << 1);
+        }
+    }
+    // y and z columns by transposing slices of the x columns
+    uint64_t matrix[64];
+    for (int pass = 0; pass < 2; pass++) {
+        uint64_t* columns = pass ? visible : opaque;
+        for (int z = 0; z < PADDED_SIZE; z++) {
+            for (int y = 0; y < PADDED_SIZE; y++) matrix[y] = columns[COLUMN_INDEX(0, y, z)];
+            transpose_slice(matrix);
+            for (int x = 0; x < PADDED_SIZE; x++) columns[COLUMN_INDEX(1, z, x)] = matrix[x];
+        }
+        for (int y = 0; y < PADDED_SIZE; y++) {
+            for (int z = 0; z < PADDED_SIZE; z++) matrix[z] = columns[COLUMN_INDEX(0, y, z)];
+            transpose_slice(matrix);
+            for (int x = 0; x < PADDED_SIZE; x++) columns[COLUMN_INDEX(2, x, y)] = matrix[x];
+        }
+    }
+
+    for (int face = 0; face < 6; face++) {
+        int a = face / 2, b = (a + 1) % 3, c = (a + 2) % 3;
+        // rows[d * CHUNK_SIZE + v] has bit u set for an exposed face at local d, u, v on axes a, b, c
+        memset(rows, 0, sizeof(uint32_t) * CHUNK_SIZE * CHUNK_SIZE);
+        for (int v = 0; v < CHUNK_SIZE; v++) {
+            for (int u = 0; u < CHUNK_SIZE; u++) {
+                int column = COLUMN_INDEX(a, u + 1, v + 1);
+                uint64_t faces = visible[column] & ~(face % 2 ? opaque[column] << 1 : opaque[column] >> 1);
+                // see-through blocks are also hidden by a neighbor of their own kind, rare enough to check one by one
+                for (uint64_t clear = faces & ~opaque[column]; clear; clear &= clear - 1) {
+                    int i = lowest_bit(clear);
+                    int p[3];
+                    p[a] = i - 1, p[b] = u, p[c] = v;
+                    BlockId id = padded.blocks[PADDED_INDEX(p[0], p[1], p[2])];
+                    BlockId neighbor = padded.blocks[PADDED_INDEX(p[0] + FACE_NORMALS[face][0], p[1] + FACE_NORMALS[face][1], p[2] + FACE_NORMALS[face][2])];
+                    if (neighbor == id) faces &= ~((uint64_t)1 << i);
+                }
+                while (faces) {
+                    int d = lowest_bit(faces) - 1;
+                    faces &= faces - 1;
+                    rows[d * CHUNK_SIZE + v] |= 1u << u;
+                }
+            }
+        }
+        for (int d = 0; d < CHUNK_SIZE; d++) {
+            uint32_t* layer = &rows[d * CHUNK_SIZE];
+            for (int v = 0; v < CHUNK_SIZE; v++) {
+                for (uint32_t bits = layer[v]; bits; bits &= bits - 1) {
+                    int u = lowest_bit(bits);
+                    int p[3];
+                    p[a] = d, p[b] = u, p[c] = v;
+                    uint8_t ao[4];
+                    keys[v * CHUNK_SIZE + u] = face_key(&padded, p, face, ao);
+                }
+            }
+            for (int v = 0; v < CHUNK_SIZE; v++) {
+                while (layer[v]) {
+                    int u = lowest_bit(layer[v]);
+                    uint32_t key = keys[v * CHUNK_SIZE + u];
+                    int width = 1, height = 1;
+                    if (!(key & FACE_KEY_SINGLE)) {
+                        // run of set bits from u, cut at the first face that looks different
+                        int run = lowest_bit(~((uint64_t)layer[v] >> u));
+                        while (width < run && keys[v * CHUNK_SIZE + u + width] == key) width++;
+                        uint32_t span = (uint32_t)((((uint64_t)1 << width) - 1) << u);
+                        for (; v + height < CHUNK_SIZE && (layer[v + height] & span) == span; height++) {
+                            bool same = true;
+                            for (int i = 0; i < width && same; i++) same = keys[(v + height) * CHUNK_SIZE + u + i] == key;
+                            if (!same) break;
+                        }
+                    }
+                    uint32_t span = (uint32_t)((((uint64_t)1 << width) - 1) << u);
+                    for (int i = 0; i < height; i++) layer[v + i] &= ~span;
+                    int min[3], size[3], p[3];
+                    p[a] = d, p[b] = u, p[c] = v;
+                    size[a] = 1, size[b] = width, size[c] = height;
+                    for (int i = 0; i < 3; i++) min[i] = base[i] + p[i];
+                    uint8_t ao[4];
+                    if (key & FACE_KEY_SINGLE) face_ao(&padded, p[0], p[1], p[2], face, ao);
+                    else memset(ao, key >> 16 & 3, sizeof(ao));
+                    createQuad(buffer, padded.blocks[PADDED_INDEX(p[0], p[1], p[2])], min, size, face, key >> 8 & 0xff, ao);
+                }
+            }
+        }
+    }
+    arena_rewind(arena, mark);
+}
+
+// level of detail, level l meshes cells of 1 << l blocks on a side
+#define LOD_COUNT 4
+#define LOD_HYSTERESIS 8.0f
+// distance from the camera to a chunk past which it drops to the next coarser level
+const float LOD_DISTANCES[LOD_COUNT - 1] = { 64.0f, 128.0f, 192.0f };
+
+// id of a downsampled cell, solid as soon as any block in it is so coarser levels only ever grow the terrain
+// the topmost block wins so hills keep their grass
+BlockId lod_cell(Chunk* chunk, int x0, int y0, int z0, int size) {
+    for (int y = y0 + size - 1; y >= y0; y--) {
+        for (int z = z0; z < z0 + size; z++) {
+            for (int x = x0; x < x0 + size; x++) {
+                BlockId id = chunk->blocks[CHUNK_INDEX(x, y, z)];
+                if (Blocks.render_layer[id] != RENDER_LAYER_NONE) return id;
+            }
+        }
+    }
+    return BLOCK_AIR;
+}
+
+// whether every block behind a face on the chunk border is solid, min is the cell's lowest block
+// the neighbor chunk covers the face at any level then, other border faces are kept as skirts
+bool lod_face_covered(World* world, const int min[3], int size, Face face) {
+    int axis = face / 2, u = (axis + 1) % 3, v = (axis + 2) % 3;
+    int p[3];
+    p[axis] = face % 2 ? min[axis] - 1 : min[axis] + size;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            p[u] = min[u] + i;
+            p[v] = min[v] + j;
+            if (!block_opaque(world_get_block(world, p[0], p[1], p[2]))) return false;
+        }
+    }
+    return true;
+}
+
+// mesh_chunk on a grid downsampled by 1 << lod
+// coarse cells are supersets of the finer ones and faces on the chunk border are only dropped when the
+// neighbor is solid at full resolution, so chunks meshed at different levels don't leave cracks between them
+void mesh_chunk_lod(MeshBuffer* buffer, World* world, Chunk* chunk, int lod) {
+    if (lod == 0) {
+        if (binary_meshing) mesh_chunk_binary(buffer, world, chunk);
+        else mesh_chunk(buffer, world, chunk);
+        return;
+    }
+    int size = 1 << lod;
+    int cells = CHUNK_SIZE >> lod;
+    Arena* arena = scratch_arena();
+    size_t mark = arena->used;
+    BlockId* grid = arena_alloc(arena, sizeof(BlockId) * cells * cells * cells);
+    for (int y = 0; y < cells; y++) {
+        for (int z = 0; z < cells; z++) {
+            for (int x = 0; x < cells; x++) {
+                grid[(y * cells + z) * cells + x] = lod_cell(chunk, x * size, y * size, z * size, size);
+            }
+        }
+    }
+    for (int y = 0; y < cells; y++) {
+        for (int z = 0; z < cells; z++) {
+            for (int x = 0; x < cells; x++) {
+                BlockId id = grid[(y * cells + z) * cells + x];
+                if (id == BLOCK_AIR) continue;
+                int min[3] = { chunk->cx * CHUNK_SIZE + x * size, chunk->cy * CHUNK_SIZE + y * size, chunk->cz * CHUNK_SIZE + z * size };
+                vec3 center = { min[0] + (size - 1) * 0.5f, min[1] + (size - 1) * 0.5f, min[2] + (size - 1) * 0.5f };
+                for (int face = 0; face < 6; face++) {
+                    int nx = x + FACE_NORMALS[face][0];
+                    int ny = y + FACE_NORMALS[face][1];
+                    int nz = z + FACE_NORMALS[face][2];
+                    if ((unsigned)nx < (unsigned)cells && (unsigned)ny < (unsigned)cells && (unsigned)nz < (unsigned)cells) {
+                        if (block_face_hidden(id, grid[(ny * cells + nz) * cells + nx])) continue;
+                    } else if (lod_face_covered(world, min, size, face)) {
+                        continue;
+                    }
+                    // light of the block in front of the middle of the face
+                    int axis = face / 2, p[3];
+                    for (int a = 0; a < 3; a++) p[a] = min[a] + size / 2;
+                    p[axis] = face % 2 ? min[axis] - 1 : min[axis] + size;
+                    createScaledFace(buffer, id, center, size, face, world_get_light(world, p[0], p[1], p[2]), NULL);
+                }
+            }
+        }
+    }
+    arena_rewind(arena, mark);
+}
+
+// level a chunk should be meshed at, current is the level it has now or -1
+// a chunk only switches once the camera is LOD_HYSTERESIS past a threshold so it doesn't flip back and forth
+int chunk_lod(Chunk* chunk, vec3 eye, int current) {
+    float distance2 = 0.0f;
+    int base[3] = { chunk->cx * CHUNK_SIZE, chunk->cy * CHUNK_SIZE, chunk->cz * CHUNK_SIZE };
+    for (int a = 0; a < 3; a++) {
+        float lo = base[a] - 0.5f, hi = base[a] + CHUNK_SIZE - 0.5f;
+        float d = eye[a] < lo ? lo - eye[a] : eye[a] > hi ? eye[a] - hi : 0.0f;
+        distance2 += d * d;
+    }
+    float distance = sqrtf(distance2);
+    int lod = 0;
+    while (lod < LOD_COUNT - 1 && distance > LOD_DISTANCES[lod]) lod++;
+    if (current < 0) return lod;
+    // a step at a time from the current level, each against its own threshold, so a jump of several levels
+    // still stops at the last threshold the camera is clearly past
+    while (current < lod && distance > LOD_DISTANCES[current] + LOD_HYSTERESIS) current++;
+    while (current > lod && distance < LOD_DISTANCES[current - 1] - LOD_HYSTERESIS) current--;
+    return current;
+}
+
+void reset_buffer(MeshBuffer* buffer) {
+    buffer->vertices_len = 0;
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) buffer->indices_len[layer] = 0;
+}
+
+void free_buffer(MeshBuffer* buffer) {
+    mem_free(MEM_MESHES, buffer->vertices, sizeof(float) * buffer->vertices_limit);
+    buffer->vertices = NULL;
+    buffer->vertices_len = buffer->vertices_limit = 0;
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        mem_free(MEM_MESHES, buffer->indices[layer], sizeof(int) * buffer->indices_limit[layer]);
+        buffer->indices[layer] = NULL;
+        buffer->indices_len[layer] = buffer->indices_limit[layer] = 0;
+    }
+}
+
+// a translucent face, its six indices move together when the chunk's translucent faces are sorted
+typedef struct {
+    float center[3];
+    float distance; // squared, from the camera at the last sort
+    unsigned int indices[6];
+} TranslucentQuad;
+
+typedef struct {
+    GLuint VAO, VBO, EBO;
+    size_t index_count;
+    size_t layer_counts[MESH_LAYER_COUNT]; // indices of each layer, stored one layer after the other
+    size_t gpu_bytes; // vertex and index buffer sizes, for MEM_GPU_BUFFERS
+    int lod;
+    // translucent faces in the order they're drawn, back to front from sorted_cell
+    TranslucentQuad* translucent;
+    size_t translucent_count;
+    int sorted_cell[3];
+    bool sorted;
+    // occlusion query of the chunk's box, held from the pool while the chunk is in view
+    GLuint query;
+    bool query_pending;
+    bool occluded;          // result of the last query that came back
+    unsigned visible_frame; // last frame the chunk passed cpu culling
+} ChunkMesh;
+
+ChunkMesh chunk_meshes[WORLD_CHUNKS_Y][WORLD_CHUNKS_XZ][WORLD_CHUNKS_XZ]; // same layout as World.chunks
+
+ChunkMesh* get_chunk_mesh(Chunk* chunk) {
+    return &chunk_meshes[chunk->cy - WORLD_MIN_Y][chunk->cz - WORLD_MIN_XZ][chunk->cx - WORLD_MIN_XZ];
+}
+
+// keeps a copy of the translucent faces for sort_translucent, they're drawn unsorted until then
+void collect_translucent_quads(ChunkMesh* mesh, MeshBuffer* buffer) {
+    size_t count = buffer->indices_len[MESH_LAYER_TRANSLUCENT] / 6;
+    if (count != mesh->translucent_count) {
+        mem_free(MEM_MESHES, mesh->translucent, sizeof(TranslucentQuad) * mesh->translucent_count);
+        mesh->translucent = count ? mem_malloc(MEM_MESHES, sizeof(TranslucentQuad) * count) : NULL;
+        mesh->translucent_count = mesh->translucent ? count : 0;
+    }
+    for (size_t i = 0; i < mesh->translucent_count; i++) {
+        TranslucentQuad* quad = &mesh->translucent[i];
+        const unsigned int* indices = &buffer->indices[MESH_LAYER_TRANSLUCENT][i * 6];
+        memcpy(quad->indices, indices, sizeof(quad->indices));
+        // a face's four vertices are pushed together, its lowest index is the first of them
+        unsigned int first = indices[0];
+        for (int j = 1; j < 6; j++) if (indices[j] < first) first = indices[j];
+        for (int a = 0; a < 3; a++) {
+            float sum = 0.0f;
+            for (int j = 0; j < 4; j++) sum += buffer->vertices[(first + j) * VERTEX_FLOATS + a];
+            quad->center[a] = sum * 0.25f;
+        }
+    }
+    mesh->sorted = false;
+}
+
+void upload_chunk_mesh(ChunkMesh* mesh, MeshBuffer* buffer) {
+    if (!mesh->VAO) {
+        glGenVertexArrays(1, &mesh->VAO);
+        glGenBuffers(1, &mesh->VBO);
+        glGenBuffers(1, &mesh->EBO);
+        glBindVertexArray(mesh->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
+        // position attribute
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        // texture coord attribute
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        // brightness attribute
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)(5 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        // texture attribute
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, VERTEX_FLOATS * sizeof(float), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(3);
+    } else {
+        glBindVertexArray(mesh->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
+    }
+    size_t index_count = mesh_index_count(buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * buffer->vertices_len, buffer->vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * index_count, NULL, GL_STATIC_DRAW);
+    size_t offset = 0;
+    for (int layer = 0; layer < MESH_LAYER_COUNT; layer++) {
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * offset, sizeof(int) * buffer->indices_len[layer], buffer->indices[layer]);
+        mesh->layer_counts[layer] = buffer->indices_len[layer];
+        offset += buffer->indices_len[layer];
+    }
+    glBindVertexArray(0);
+    mesh->index_count = index_count;
+    size_t gpu_bytes = sizeof(float) * buffer->vertices_len + sizeof(int) * index_count;
+    mem_track(MEM_GPU_BUFFERS, (ptrdiff_t)gpu_bytes - (ptrdiff_t)mesh->gpu_bytes);
+    mesh->gpu_bytes = gpu_bytes;
+    collect_translucent_quads(mesh, buffer);
+}
+
+// queues every chunk whose level of detail changed since it was last meshed
+void update_chunk_lods(World* world, vec3 eye) {
+    for (int y = 0; y < WORLD_CHUNKS_Y; y++) {
+        for (int z = 0; z < WORLD_CHUNKS_XZ; z++) {
+            for (int x = 0; x < WORLD_CHUNKS_XZ; x++) {
+                Chunk* chunk = world->chunks[y][z][x];
+                ChunkMesh* mesh = &chunk_meshes[y][z][x];
+                if (!chunk || !mesh->VAO) continue;
+                if (chunk_lod(chunk, eye, mesh->lod) != mesh->lod) world_mark_dirty(world, chunk);
+            }
+        }
+    }
+}
+
+// remeshes every chunk queued since the last call at the level for eye, scratch is reused between chunks
+void remesh_dirty_chunks(World* world, MeshBuffer* scratch, vec3 eye) {
+    Chunk* chunk;
+    while ((chunk = world_pop_dirty(world))) {
+        if (!world_touch_chunk(world, chunk)) continue;
+        ChunkMesh* mesh = get_chunk_mesh(chunk);
+        int lod = chunk_lod(chunk, eye, mesh->VAO ? mesh->lod : -1);
+        chunk_update_visibility(chunk);
+        reset_buffer(scratch);
+        mesh_chunk_lod(scratch, world, chunk, lod);
+        upload_chunk_mesh(mesh, scratch);
+        mesh->lod = lod;
+        arena_reset(scratch_arena()); // one chunk is one job
+    }
+}
+
+// startup tasks, world generation -> lighting -> one meshing job per chunk, all on the job pool
+bool generate_world_task(void* arg, int item) {
+    world = new_World();
+    if (!world) {
+        fprintf(stderr, "Failed to allocate the world\n");
+        return false;
+    }
+    world_generate(world);
+    return true;
+}
+
+// the light thread does the work, the worker only waits for it so meshing can't start on unlit chunks,
+// that worker is held for the whole of the lighting and isn't free for other startup jobs meanwhile
+bool light_world_task(void* arg, int item) {
+    if (!light_engine_start(&light_engine, world)) {
+        fprintf(stderr, "Failed to start the light thread\n");
+        return false;
+    }
+    light_engine_wait(&light_engine);
+    // every chunk is meshed by the next task, nothing is left for remesh_dirty_chunks
+    light_engine_collect(&light_engine, world);
+    while (world_pop_dirty(world));
+    return true;
+}
+
+// most chunks start out at a lower level of detail and mesh to about a thousand floats, the full detail ones around
+// the camera grow their buffers, to at most a quarter of MESH_STAGING_FLOATS with merged faces
+#define STARTUP_MESH_FLOATS 4096
+
+// meshes built by the workers for the main thread to upload, indexed like World.chunks
+typedef struct {
+    vec3 eye;
+    MeshBuffer buffers[WORLD_CHUNK_COUNT];
+    int lods[WORLD_CHUNK_COUNT];
+} StartupMeshes;
+
+// chunks meshed by one item of the meshing task, every item has to fit the job queue at once or the rest would
+// run inline on the worker that released the task
+#define STARTUP_MESH_CHUNKS_PER_ITEM 8
+#define STARTUP_MESH_ITEMS (WORLD_CHUNK_COUNT / STARTUP_MESH_CHUNKS_PER_ITEM)
+_Static_assert(WORLD_CHUNK_COUNT % STARTUP_MESH_CHUNKS_PER_ITEM == 0, "chunks have to split evenly into items");
+_Static_assert(STARTUP_MESH_ITEMS <= JOB_QUEUE_SIZE, "meshing items don't fit the job queue");
+
+bool mesh_chunk_task(void* arg, int item) {
+    StartupMeshes* meshes = arg;
+    for (int i = item * STARTUP_MESH_CHUNKS_PER_ITEM; i < (item + 1) * STARTUP_MESH_CHUNKS_PER_ITEM; i++) {
+        Chunk* chunk = (&world->chunks[0][0][0])[i];
+        if (!chunk) continue;
+        int lod = chunk_lod(chunk, meshes->eye, -1);
+        chunk_update_visibility(chunk);
+        MeshBuffer* buffer = &meshes->buffers[i];
+        *buffer = new_MeshBuffer_sized(STARTUP_MESH_FLOATS, STARTUP_MESH_FLOATS / 4);
+        mesh_chunk_lod(buffer, world, chunk, lod);
+        meshes->lods[i] = lod;
+        arena_reset(scratch_arena()); // one chunk is one job as far as the arena goes
+    }
+    return true;
+}
+
+// uploads and frees what mesh_chunk_task built, the meshing task has to be done
+void upload_startup_meshes(StartupMeshes* meshes) {
+    for (int i = 0; i < WORLD_CHUNK_COUNT; i++) {
+        Chunk* chunk = (&world->chunks[0][0][0])[i];
+        if (!chunk || !meshes->buffers[i].vertices) continue;
+        ChunkMesh* mesh = get_chunk_mesh(chunk);
+        upload_chunk_mesh(mesh, &meshes->buffers[i]);
+        mesh->lod = meshes->lods[i];
+        free_buffer(&meshes->buffers[i]);
+    }
+}
+
+// faces are written back in batches of this many
+#define TRANSLUCENT_SORT_BATCH 256
+
+// orders the translucent faces back to front from the camera and rewrites their range of the index buffer
+// faces lie on the planes between blocks, the camera only changes side of one when it moves into another block so
+// that's the only time a chunk is resorted, the order from last time is nearly right and insertion sort is close
+// to linear on it
+void sort_translucent(ChunkMesh* mesh, vec3 eye) {
+    int cell[3];
+    for (int a = 0; a < 3; a++) cell[a] = (int)floorf(eye[a] + 0.5f);
+    if (mesh->sorted && memcmp(cell, mesh->sorted_cell, sizeof(cell)) == 0) return;
+    TranslucentQuad* quads = mesh->translucent;
+    for (size_t i = 0; i < mesh->translucent_count; i++) {
+        quads[i].distance = glm_vec3_distance2(quads[i].center, eye);
+    }
+    for (size_t i = 1; i < mesh->translucent_count; i++) {
+        TranslucentQuad quad = quads[i];
+        size_t j = i;
+        for (; j > 0 && quads[j - 1].distance < quad.distance; j--) quads[j] = quads[j - 1];
+        quads[j] = quad;
+    }
+    size_t offset = mesh->layer_counts[MESH_LAYER_OPAQUE] + mesh->layer_counts[MESH_LAYER_CUTOUT];
+    unsigned int batch[TRANSLUCENT_SORT_BATCH * 6];
+    glBindVertexArray(mesh->VAO);
+    for (size_t i = 0; i < mesh->translucent_count; i += TRANSLUCENT_SORT_BATCH) {
+        size_t count = mesh->translucent_count - i < TRANSLUCENT_SORT_BATCH ? mesh->translucent_count - i : TRANSLUCENT_SORT_BATCH;
+        for (size_t j = 0; j < count; j++) memcpy(&batch[j * 6], quads[i + j].indices, sizeof(quads[i + j].indices));
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * (offset + i * 6), sizeof(int) * count * 6, batch);
+    }
+    memcpy(mesh->sorted_cell, cell, sizeof(cell));
+    mesh->sorted = true;
+}
+
+void draw_chunk_layer(ChunkMesh* mesh, int layer) {
+    size_t offset = 0;
+    for (int i = 0; i < layer; i++) offset += mesh->layer_counts[i];
+    glBindVertexArray(mesh->VAO);
+    glDrawElements(GL_TRIANGLES, mesh->layer_counts[layer], GL_UNSIGNED_INT, (void*)(sizeof(int) * offset));
 }
 
+// camera state every program reads from one uniform buffer, mirrors the std140 Camera block in the shaders
+// mat4 and vec4 members are 16 byte aligned in std140 already so the struct needs no padding
+typedef struct {
+    mat4 view;
+    mat4 projection;
+    mat4 viewproj;
+    vec4 planes[6]; // frustum planes of viewproj, as glm_frustum_planes returns them
+    vec4 position;  // eye position, w unused
+} CameraBlock;
+
+#define CAMERA_BINDING 0
+
 struct {
-    UV Cobbled_Stone, Grass, Dirt, Grass_Side;
-} Textures = {};
+    GLuint ubo;
+    CameraBlock block;
+    bool uploaded;
+} Camera;
+
+void init_camera() {
+    glGenBuffers(1, &Camera.ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, Camera.ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, Camera.ubo);
+    mem_track(MEM_GPU_BUFFERS, sizeof(CameraBlock));
+    Camera.uploaded = false;
+}
+
+// points the program's Camera block at the shared buffer, glsl 330 can't set the binding itself
+bool bind_camera(GLuint program) {
+    GLuint index = glGetUniformBlockIndex(program, "Camera");
+    if (index == GL_INVALID_INDEX) return false;
+    glUniformBlockBinding(program, index, CAMERA_BINDING);
+    return true;
+}
 
+// uploads the camera when the view or projection differs from what's in the buffer, a still camera costs nothing
+void update_camera(mat4 projection, mat4 view, vec3 eye) {
+    if (Camera.uploaded
+        && memcmp(Camera.block.view, view, sizeof(mat4)) == 0
+        && memcmp(Camera.block.projection, projection, sizeof(mat4)) == 0) return;
+    glm_mat4_copy(view, Camera.block.view);
+    glm_mat4_copy(projection, Camera.block.projection);
+    glm_mat4_mul(projection, view, Camera.block.viewproj);
+    glm_frustum_planes(Camera.block.viewproj, Camera.block.planes);
+    glm_vec4(eye, 1.0f, Camera.block.position);
+    glBindBuffer(GL_UNIFORM_BUFFER, Camera.ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &Camera.block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    Camera.uploaded = true;
+}
+
+void free_camera() {
+    glDeleteBuffers(1, &Camera.ubo);
+    mem_track(MEM_GPU_BUFFERS, -(ptrdiff_t)sizeof(CameraBlock));
+}
 
+// query objects are reused instead of created and deleted every frame
 typedef struct {
-    const char* name;
-    UV* top_texture; 
-    UV* bottom_texture; 
-    UV* side_texture;
-}  Block;
+    GLuint* queries; // free queries
+    size_t count;
+    size_t generated;
+} QueryPool;
+
+#define QUERY_POOL_GROW 64
+
+GLuint acquire_query(QueryPool* pool) {
+    if (pool->count == 0) {
+        // room for every query ever generated, they can all be released at once
+        pool->queries = realloc(pool->queries, sizeof(GLuint) * (pool->generated + QUERY_POOL_GROW));
+        glGenQueries(QUERY_POOL_GROW, pool->queries);
+        pool->count = QUERY_POOL_GROW;
+        pool->generated += QUERY_POOL_GROW;
+    }
+    return pool->queries[--pool->count];
+}
+
+void release_query(QueryPool* pool, GLuint query) {
+    pool->queries[pool->count++] = query;
+}
+
+// queries held by chunk meshes have to be released first
+void free_query_pool(QueryPool* pool) {
+    glDeleteQueries(pool->count, pool->queries);
+    free(pool->queries);
+    *pool = (QueryPool){0};
+}
+
+// boxes are grown a little so terrain on a chunk border doesn't hide its own chunk's box
+#define OCCLUSION_BOX_MARGIN 0.5f
 
 struct {
-    Block Grass_Block;
-    Block Dirt_Block;
-    Block Cobbled_Stone_Block;
-} Blocks;
-
-void init_Blocks() {
-    Blocks.Grass_Block = (Block){
-        .top_texture = &Textures.Grass,
-            .side_texture = &Textures.Grass_Side,
-            .bottom_texture = &Textures.Dirt,
-            .name = "Grass Block",
+    GLuint program;
+    GLint box_min_loc, box_size_loc;
+    GLuint VAO, VBO, EBO; // unit cube
+    QueryPool pool;
+    unsigned frame;
+} Occlusion;
+
+bool init_occlusion() {
+    Occlusion.program = create_shader_program(
+        (const char*)assets_shaders_box_vert_glsl_start,
+        (const char*)assets_shaders_box_frag_glsl_start,
+        NULL, NULL);
+    if (!Occlusion.program || !bind_camera(Occlusion.program)) return false;
+    Occlusion.box_min_loc = glGetUniformLocation(Occlusion.program, "boxMin");
+    Occlusion.box_size_loc = glGetUniformLocation(Occlusion.program, "boxSize");
+
+    const float corners[8][3] = {
+        { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+        { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 },
     };
-    Blocks.Dirt_Block = (Block){
-        .top_texture = &Textures.Dirt,
-            .side_texture = &Textures.Dirt,
-            .bottom_texture = &Textures.Dirt,
-            .name = "Dirt Block",
-    };
-    Blocks.Cobbled_Stone_Block = (Block){
-        .top_texture = &Textures.Cobbled_Stone,
-            .side_texture = &Textures.Cobbled_Stone,
-            .bottom_texture = &Textures.Cobbled_Stone,
-            .name = "Cobbled Stone Block",
+    const unsigned int indices[36] = {
+        0, 2, 1, 0, 3, 2, // -z
+        4, 5, 6, 4, 6, 7, // +z
+        0, 4, 7, 0, 7, 3, // -x
+        1, 2, 6, 1, 6, 5, // +x
+        0, 1, 5, 0, 5, 4, // -y
+        3, 7, 6, 3, 6, 2, // +y
     };
+    glGenVertexArrays(1, &Occlusion.VAO);
+    glGenBuffers(1, &Occlusion.VBO);
+    glGenBuffers(1, &Occlusion.EBO);
+    glBindVertexArray(Occlusion.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, Occlusion.VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Occlusion.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    mem_track(MEM_GPU_BUFFERS, sizeof(corners) + sizeof(indices));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    return true;
 }
 
-unsigned char* get_atlas(int* out_width, int*out_height, int* out_channels, int desired) {
-    Img cobbled_stone = load_image(__assets_textures_cobbled_stone_png, __assets_textures_cobbled_stone_png_len, desired, &Textures.Cobbled_Stone);
-    Img grass = load_image(__assets_textures_grass_png, __assets_textures_grass_png_len, desired, &Textures.Grass);
-    Img dirt = load_image(__assets_textures_dirt_png, __assets_textures_dirt_png_len, desired, &Textures.Dirt);
-    Img grass_side = load_image(__assets_textures_grass_side_png, __assets_textures_grass_side_png_len, desired, &Textures.Grass_Side);
-    unsigned char* atlas =  generate_texture_atlas_struct((Img[]) {
-            cobbled_stone,
-            grass,
-            dirt,
-            grass_side
-            }, 4, desired, out_width, out_height, out_channels);
-    stbi_image_free(cobbled_stone.data);
-    stbi_image_free(grass.data);
-    stbi_image_free(dirt.data);
-    stbi_image_free(grass_side.data);
-    return atlas;
+void free_occlusion() {
+    free_query_pool(&Occlusion.pool);
+    glDeleteVertexArrays(1, &Occlusion.VAO);
+    glDeleteBuffers(1, &Occlusion.VBO);
+    glDeleteBuffers(1, &Occlusion.EBO);
+    mem_track(MEM_GPU_BUFFERS, -(ptrdiff_t)(8 * 3 * sizeof(float) + 36 * sizeof(unsigned int)));
+    glDeleteProgram(Occlusion.program);
 }
 
-typedef struct {
-    float* vertices;
-    size_t vertices_len;
-    size_t vertices_limit;
-    unsigned int* indices;
-    size_t indices_len;
-    size_t indices_limit;
-} MeshBuffer;
+bool init_sky() {
+    Sky.program = create_shader_program(
+        (const char*)assets_shaders_sky_vert_glsl_start,
+        (const char*)assets_shaders_sky_frag_glsl_start,
+        NULL, NULL);
+    if (!Sky.program) return false;
+    glUseProgram(Sky.program);
+    glUniform2f(glGetUniformLocation(Sky.program, "screenSize"), (float)WIDTH, (float)HEIGHT);
+    glGenVertexArrays(1, &Sky.VAO);
+    return true;
+}
 
-MeshBuffer new_MeshBuffer() {
-    return (MeshBuffer) {
-        .indices = malloc(sizeof(int)),//malloc 1 int
-        .indices_limit=1,
-        .indices_len=0,
-        .vertices = malloc(sizeof(float)), //malloc 1 float
-        .vertices_limit=1,
-        .vertices_len=0,
-    };
+void free_sky() {
+    glDeleteVertexArrays(1, &Sky.VAO);
+    glDeleteProgram(Sky.program);
 }
-void push_vert(MeshBuffer* buffer, float vert) {
-    if(buffer->vertices_limit <= buffer->vertices_len) {
-        buffer->vertices_limit*=2;
-        buffer->vertices = realloc(buffer->vertices, sizeof(float) * buffer->vertices_limit);
+
+// picks up the query results that have arrived without waiting on the gpu, other chunks keep their last result
+// queries of chunks that left the view go back to the pool
+void read_occlusion_results() {
+    ChunkMesh* meshes = &chunk_meshes[0][0][0];
+    for (int i = 0; i < WORLD_CHUNK_COUNT; i++) {
+        ChunkMesh* mesh = &meshes[i];
+        if (!mesh->query) continue;
+        if (mesh->query_pending) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(mesh->query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) continue;
+            GLuint passed = 0;
+            glGetQueryObjectuiv(mesh->query, GL_QUERY_RESULT, &passed);
+            mesh->occluded = !passed;
+            mesh->query_pending = false;
+        }
+        if (mesh->visible_frame != Occlusion.frame) {
+            release_query(&Occlusion.pool, mesh->query);
+            mesh->query = 0;
+            mesh->occluded = false;
+        }
     }
-    buffer->vertices[buffer->vertices_len] = vert;
-    buffer->vertices_len++;
 }
-void push_index(MeshBuffer* buffer, unsigned int index) {
-    if(buffer->indices_limit <= buffer->indices_len) {
-        buffer->indices_limit*=2;
-        buffer->indices = realloc(buffer->indices , sizeof(int) * buffer->indices_limit);
-    }
-    buffer->indices[buffer->indices_len] = index;
-    buffer->indices_len++;
-}
-
-void createBlock(MeshBuffer* buffer, Block block, vec3 pos) {
-    size_t prelen = buffer->vertices_len/5;
-    float vertices[] = {
-        // posX face
-        pos[0]+0.5f,pos[1]+  0.5f,pos[2]+ -0.5f,  block.side_texture->umax, block.side_texture->vmax,
-        pos[0]+0.5f,pos[1]+ -0.5f,pos[2]+ -0.5f,  block.side_texture->umax, block.side_texture->vmin,
-        pos[0]+0.5f,pos[1]+ -0.5f,pos[2]+  0.5f,  block.side_texture->umin, block.side_texture->vmin,
-        pos[0]+0.5f,pos[1]+  0.5f,pos[2]+  0.5f,  block.side_texture->umin, block.side_texture->vmax,
-
-        // negX face
-        pos[0]+-0.5f,pos[1]+  0.5f,pos[2]+  0.5f,  block.side_texture->umax, block.side_texture->vmax,
-        pos[0]+-0.5f,pos[1]+ -0.5f,pos[2]+  0.5f,  block.side_texture->umax, block.side_texture->vmin,
-        pos[0]+-0.5f,pos[1]+ -0.5f,pos[2]+ -0.5f,  block.side_texture->umin, block.side_texture->vmin,
-        pos[0]+-0.5f,pos[1]+  0.5f,pos[2]+ -0.5f,  block.side_texture->umin, block.side_texture->vmax,
-
-        // posY face
-        pos[0]+-0.5f,pos[1]+  0.5f,pos[2]+  0.5f,  block.top_texture->umin, block.top_texture->vmax,
-        pos[0]+0.5f,pos[1]+  0.5f,pos[2]+  0.5f,  block.top_texture->umax, block.top_texture->vmax,
-        pos[0]+0.5f,pos[1]+  0.5f,pos[2]+ -0.5f,  block.top_texture->umax, block.top_texture->vmin,
-        pos[0]+-0.5f,pos[1]+  0.5f,pos[2]+ -0.5f,  block.top_texture->umin, block.top_texture->vmin,
-
-        // negY face
-        pos[0]+-0.5f,pos[1]+ -0.5f,pos[2]+ -0.5f,  block.bottom_texture->umin, block.bottom_texture->vmax,
-        pos[0]+0.5f,pos[1]+ -0.5f,pos[2]+ -0.5f,  block.bottom_texture->umax, block.bottom_texture->vmax,
-        pos[0]+0.5f,pos[1]+ -0.5f,pos[2]+  0.5f,  block.bottom_texture->umax, block.bottom_texture->vmin,
-        pos[0]+-0.5f,pos[1]+ -0.5f,pos[2]+  0.5f,  block.bottom_texture->umin, block.bottom_texture->vmin,
-
-        // posZ face
-        pos[0]+0.5f,pos[1]+  0.5f,pos[2]+  0.5f,  block.side_texture->umax, block.side_texture->vmax,
-        pos[0]+0.5f,pos[1]+ -0.5f,pos[2]+  0.5f,  block.side_texture->umax, block.side_texture->vmin,
-        pos[0]+-0.5f,pos[1]+ -0.5f,pos[2]+  0.5f,  block.side_texture->umin, block.side_texture->vmin,
-        pos[0]+-0.5f,pos[1]+  0.5f,pos[2]+  0.5f,  block.side_texture->umin, block.side_texture->vmax,
-
-        // negZ face
-        pos[0]+-0.5f,pos[1]+  0.5f,pos[2]+ -0.5f,  block.side_texture->umax, block.side_texture->vmax,
-        pos[0]+-0.5f,pos[1]+ -0.5f,pos[2]+ -0.5f,  block.side_texture->umax, block.side_texture->vmin,
-        pos[0]+0.5f,pos[1]+ -0.5f,pos[2]+ -0.5f,  block.side_texture->umin, block.side_texture->vmin,
-        pos[0]+0.5f,pos[1]+  0.5f,pos[2]+ -0.5f,  block.side_texture->umin, block.side_texture->vmax,
-    };
 
-    unsigned int indices[] = {
-        prelen+2,prelen+1,prelen+0,
-        prelen+3,prelen+2,prelen+0,
-        prelen+6,prelen+5,prelen+4,
-        prelen+7,prelen+6,prelen+4,
-        prelen+8,prelen+9,prelen+10,
-        prelen+8,prelen+10,prelen+11,
-        prelen+12,prelen+13,prelen+14,
-        prelen+12,prelen+14,prelen+15,
-        prelen+18,prelen+17,prelen+16,
-        prelen+19,prelen+18,prelen+16,
-        prelen+22,prelen+21,prelen+20,
-        prelen+23,prelen+22,prelen+20
-    };
-    for(size_t i = 0; i < sizeof(indices)/sizeof(int); i++) {
-        push_index(buffer, indices[i]);
+// while occlusion culling is off nothing reads the results, every query goes back to the pool and every chunk
+// counts as visible, results still in flight are dropped
+void release_occlusion_queries() {
+    ChunkMesh* meshes = &chunk_meshes[0][0][0];
+    for (int i = 0; i < WORLD_CHUNK_COUNT; i++) {
+        ChunkMesh* mesh = &meshes[i];
+        mesh->occluded = false;
+        if (!mesh->query) continue;
+        release_query(&Occlusion.pool, mesh->query);
+        mesh->query = 0;
+        mesh->query_pending = false;
     }
-    for(size_t i = 0; i < sizeof(vertices)/sizeof(float); i++) {
-        push_vert(buffer, vertices[i]);
+}
+
+bool init_instances(const char* frag_shader) {
+    Instances.program = create_shader_program(
+        (const char*)assets_shaders_instance_vert_glsl_start, frag_shader, NULL, "#define ALPHA_TEST\n");
+    if (!Instances.program || !bind_camera(Instances.program)) return false;
+
+    // corner position, uv and face
+    float vertices[6 * 4 * 6];
+    unsigned int indices[6 * 6];
+    for (int face = 0; face < 6; face++) {
+        for (int i = 0; i < 4; i++) {
+            float* vertex = &vertices[(face * 4 + i) * 6];
+            memcpy(vertex, FACE_CORNERS[face][i], sizeof(float) * 5);
+            vertex[5] = face;
+        }
+        for (int i = 0; i < 6; i++) indices[face * 6 + i] = face * 4 + FACE_INDICES[face][i];
+    }
+    glGenVertexArrays(1, &Instances.VAO);
+    glGenBuffers(1, &Instances.VBO);
+    glGenBuffers(1, &Instances.EBO);
+    glGenBuffers(1, &Instances.instance_buffer);
+    glBindVertexArray(Instances.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, Instances.VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Instances.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    // the instance attributes are pointed at the region drawn from in draw_instances
+    glBindBuffer(GL_ARRAY_BUFFER, Instances.instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(BlockInstance) * INSTANCE_CAPACITY * INSTANCE_FRAMES, NULL, GL_STREAM_DRAW);
+    for (int attribute = 3; attribute <= 5; attribute++) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
     }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &Instances.face_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, Instances.face_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(Blocks.face_textures), Blocks.face_textures, GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glGenTextures(1, &Instances.face_texture);
+    glActiveTexture(GL_TEXTURE0 + INSTANCE_FACE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, Instances.face_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R8UI, Instances.face_buffer);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(Instances.program);
+    glUniform1i(glGetUniformLocation(Instances.program, "faceTextures"), INSTANCE_FACE_UNIT);
+
+    mem_track(MEM_GPU_BUFFERS, sizeof(vertices) + sizeof(indices) + sizeof(Blocks.face_textures)
+        + sizeof(BlockInstance) * INSTANCE_CAPACITY * INSTANCE_FRAMES);
+    return true;
 }
-void free_buffer(MeshBuffer* buffer) {
-    free(buffer->vertices);
-    free(buffer->indices);
-    buffer->vertices = NULL;
-    buffer->indices = NULL;
-    buffer->vertices_len = buffer->vertices_limit = 0;
-    buffer->indices_len = buffer->indices_limit = 0;
+
+void free_instances() {
+    for (int i = 0; i < INSTANCE_FRAMES; i++) {
+        if (Instances.fences[i]) glDeleteSync(Instances.fences[i]);
+    }
+    glDeleteVertexArrays(1, &Instances.VAO);
+    glDeleteBuffers(1, &Instances.VBO);
+    glDeleteBuffers(1, &Instances.EBO);
+    glDeleteBuffers(1, &Instances.instance_buffer);
+    glDeleteTextures(1, &Instances.face_texture);
+    glDeleteBuffers(1, &Instances.face_buffer);
+    mem_track(MEM_GPU_BUFFERS, -(ptrdiff_t)(6 * 4 * 6 * sizeof(float) + 6 * 6 * sizeof(unsigned int)
+        + sizeof(Blocks.face_textures) + sizeof(BlockInstance) * INSTANCE_CAPACITY * INSTANCE_FRAMES));
+    glDeleteProgram(Instances.program);
 }
 
-int main(void) {
-    init_Blocks();
-    char* vert_shader = len_to_cstr(__assets_shaders_vert_glsl, __assets_shaders_vert_glsl_len);
-    char* frag_shader = len_to_cstr(__assets_shaders_frag_glsl, __assets_shaders_frag_glsl_len);
-    char* geo_shader = len_to_cstr(__assets_shaders_geo_glsl, __assets_shaders_geo_glsl_len);
+// maps this frame's region for push_instance, the region is written front to back and never read
+void begin_instances() {
+    GLsync fence = Instances.fences[Instances.region];
+    if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, INSTANCE_FENCE_TIMEOUT);
+        glDeleteSync(fence);
+        Instances.fences[Instances.region] = 0;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, Instances.instance_buffer);
+    Instances.mapped = glMapBufferRange(GL_ARRAY_BUFFER,
+        sizeof(BlockInstance) * INSTANCE_CAPACITY * Instances.region, sizeof(BlockInstance) * INSTANCE_CAPACITY,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    Instances.count = 0;
+}
+
+void push_instance(BlockId block, vec3 position, float scale, float yaw, float light) {
+    if (!Instances.mapped || Instances.count == INSTANCE_CAPACITY) return;
+    BlockInstance* instance = &Instances.mapped[Instances.count++];
+    glm_vec3_copy(position, instance->position);
+    instance->scale = scale;
+    instance->yaw = yaw;
+    instance->light = light;
+    instance->block = block;
+}
+
+// unmaps the region and draws everything pushed since begin_instances, the next frame writes the next region
+void draw_instances() {
+    if (!Instances.mapped) return;
+    glBindBuffer(GL_ARRAY_BUFFER, Instances.instance_buffer);
+    bool intact = glUnmapBuffer(GL_ARRAY_BUFFER);
+    Instances.mapped = NULL;
+    if (intact && Instances.count) {
+        size_t offset = sizeof(BlockInstance) * INSTANCE_CAPACITY * Instances.region;
+        glBindVertexArray(Instances.VAO);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(BlockInstance), (void*)(offset + offsetof(BlockInstance, position)));
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(BlockInstance), (void*)(offset + offsetof(BlockInstance, yaw)));
+        glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(BlockInstance), (void*)(offset + offsetof(BlockInstance, block)));
+        glActiveTexture(GL_TEXTURE0 + INSTANCE_FACE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, Instances.face_texture);
+        glActiveTexture(GL_TEXTURE0);
+        glUseProgram(Instances.program);
+        glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, Instances.count);
+        Instances.fences[Instances.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        Instances.region = (Instances.region + 1) % INSTANCE_FRAMES;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void push_debris_instances() {
+    for (size_t i = 0; i < debris.count; i++) {
+        DebrisPiece* piece = &debris.pieces[i];
+        push_instance(piece->block, debris.bodies[i].center, debris_scale(piece), piece->yaw, piece->brightness);
+    }
+}
+
+#define PREVIEW_SCALE 0.3f
+#define PREVIEW_SPIN 1.5f // radians per second
+
+// the selected block turning slowly in the cell a click would place it in
+void push_place_preview() {
+    if (!looking_at.hit || looking_at.face == FACE_NONE) return;
+    vec3 cell;
+    for (int a = 0; a < 3; a++) cell[a] = looking_at.block[a] + FACE_NORMALS[looking_at.face][a];
+    push_instance(selected_block, cell, PREVIEW_SCALE, (float)fmod(now_seconds() * PREVIEW_SPIN, 2.0 * GLM_PI), 1.0f);
+}
+
+// opaque faces of the chunks visible at their last query written to depth only, front to back
+void draw_depth_prepass(VisibleChunks* visible) {
+    ChunkMesh* meshes = &chunk_meshes[0][0][0];
+    glUseProgram(Chunk_Programs.depth);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    for (size_t i = 0; i < visible->count; i++) {
+        ChunkMesh* mesh = &meshes[visible->chunks[i]];
+        if (!mesh->layer_counts[MESH_LAYER_OPAQUE] || mesh->occluded) continue;
+        draw_chunk_layer(mesh, MESH_LAYER_OPAQUE);
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+// opaque then cutout faces of the chunks drawn in one go, either those visible at their last query or the occluded
+// ones under conditional render on it, the visible list is nearest first
+// with the pre-pass the visible chunks' opaque faces are shaded under GL_EQUAL, the chunks under conditional render
+// weren't in it and are depth tested as usual
+void draw_solid_layers(VisibleChunks* visible, bool occluded) {
+    ChunkMesh* meshes = &chunk_meshes[0][0][0];
+    bool prepass = depth_prepass && !occluded;
+    if (prepass) {
+        draw_depth_prepass(visible);
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+    for (int layer = MESH_LAYER_OPAQUE; layer <= MESH_LAYER_CUTOUT; layer++) {
+        glUseProgram(layer == MESH_LAYER_CUTOUT ? Chunk_Programs.cutout : Chunk_Programs.opaque);
+        for (size_t i = 0; i < visible->count; i++) {
+            ChunkMesh* mesh = &meshes[visible->chunks[solid_back_to_front ? visible->count - 1 - i : i]];
+            if (!mesh->layer_counts[layer] || mesh->occluded != occluded) continue;
+            if (occluded) {
+                if (!mesh->query) continue;
+                glBeginConditionalRender(mesh->query, GL_QUERY_WAIT);
+            }
+            draw_chunk_layer(mesh, layer);
+            if (occluded) glEndConditionalRender();
+        }
+        if (prepass && layer == MESH_LAYER_OPAQUE) {
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        }
+    }
+}
+
+// sky color and the crosshair over it, a full screen triangle behind everything drawn after the solid faces so
+// only the pixels no face covered run its fragment shader, it leaves depth alone for the occlusion queries
+void draw_sky() {
+    glUseProgram(Sky.program);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(Sky.VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDepthMask(GL_TRUE);
+}
+
+// translucent faces over everything else, chunks and the faces in them back to front, blended without writing depth
+void draw_translucent_layer(VisibleChunks* visible, vec3 eye) {
+    ChunkMesh* meshes = &chunk_meshes[0][0][0];
+    glUseProgram(Chunk_Programs.opaque);
+    glEnable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+    // the visible list is nearest first
+    for (size_t i = visible->count; i-- > 0;) {
+        ChunkMesh* mesh = &meshes[visible->chunks[i]];
+        if (!mesh->layer_counts[MESH_LAYER_TRANSLUCENT] || (mesh->occluded && !mesh->query)) continue;
+        sort_translucent(mesh, eye);
+        if (mesh->occluded) glBeginConditionalRender(mesh->query, GL_QUERY_WAIT);
+        draw_chunk_layer(mesh, MESH_LAYER_TRANSLUCENT);
+        if (mesh->occluded) glEndConditionalRender();
+    }
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+// draws the chunks that passed cpu culling, a pass per render layer, and the instances pushed this frame before the
+// translucent faces
+// chunks visible at their last query are drawn first, then the boxes of the chunks without a query in flight are
+// queried against that depth buffer, chunks occluded last time are drawn under conditional render on their query
+// so the gpu skips them unless they came back into view, the cpu never waits for a result
+void draw_chunks(VisibleChunks* visible, vec3 eye) {
+    ChunkMesh* meshes = &chunk_meshes[0][0][0];
+    Occlusion.frame++;
+    for (size_t i = 0; i < visible->count; i++) {
+        meshes[visible->chunks[i]].visible_frame = Occlusion.frame;
+    }
+    if (!occlusion_culling) {
+        release_occlusion_queries();
+        draw_solid_layers(visible, false);
+        draw_instances();
+        draw_sky();
+        draw_translucent_layer(visible, eye);
+        glBindVertexArray(0);
+        return;
+    }
+    read_occlusion_results();
+
+    draw_solid_layers(visible, false);
+
+    glUseProgram(Occlusion.program);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE); // back faces still count when the near plane clips the front ones
+    glBindVertexArray(Occlusion.VAO);
+    for (size_t i = 0; i < visible->count; i++) {
+        int slot = visible->chunks[i];
+        ChunkMesh* mesh = &meshes[slot];
+        if (!mesh->index_count || mesh->query_pending) continue;
+        vec3 box_min = {
+            (slot % WORLD_CHUNKS_XZ + WORLD_MIN_XZ) * CHUNK_SIZE - 0.5f - OCCLUSION_BOX_MARGIN,
+            (slot / (WORLD_CHUNKS_XZ * WORLD_CHUNKS_XZ) + WORLD_MIN_Y) * CHUNK_SIZE - 0.5f - OCCLUSION_BOX_MARGIN,
+            (slot / WORLD_CHUNKS_XZ % WORLD_CHUNKS_XZ + WORLD_MIN_XZ) * CHUNK_SIZE - 0.5f - OCCLUSION_BOX_MARGIN,
+        };
+        float box_size = CHUNK_SIZE + 2.0f * OCCLUSION_BOX_MARGIN;
+        bool inside = true;
+        for (int a = 0; a < 3; a++) {
+            inside &= eye[a] > box_min[a] - 1.0f && eye[a] < box_min[a] + box_size + 1.0f;
+        }
+        if (inside) {
+            // the camera's own chunk is never occluded
+            mesh->occluded = false;
+            continue;
+        }
+        if (!mesh->query) mesh->query = acquire_query(&Occlusion.pool);
+        glUniform3fv(Occlusion.box_min_loc, 1, box_min);
+        glUniform3f(Occlusion.box_size_loc, box_size, box_size, box_size);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, mesh->query);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        mesh->query_pending = true;
+    }
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    draw_solid_layers(visible, true);
+    draw_instances();
+    draw_sky();
+    draw_translucent_layer(visible, eye);
+    glBindVertexArray(0);
+}
+
+void free_chunk_meshes() {
+    for (int y = 0; y < WORLD_CHUNKS_Y; y++) {
+        for (int z = 0; z < WORLD_CHUNKS_XZ; z++) {
+            for (int x = 0; x < WORLD_CHUNKS_XZ; x++) {
+                ChunkMesh* mesh = &chunk_meshes[y][z][x];
+                if (mesh->query) release_query(&Occlusion.pool, mesh->query);
+                mem_free(MEM_MESHES, mesh->translucent, sizeof(TranslucentQuad) * mesh->translucent_count);
+                if (!mesh->VAO) continue;
+                glDeleteVertexArrays(1, &mesh->VAO);
+                glDeleteBuffers(1, &mesh->VBO);
+                glDeleteBuffers(1, &mesh->EBO);
+                mem_track(MEM_GPU_BUFFERS, -(ptrdiff_t)mesh->gpu_bytes);
+            }
+        }
+    }
+}
+
+// chunk orders and the depth pre-pass compared by --draw-bench, the last mode adds a cloud of instanced blocks
+typedef enum {
+    DRAW_BACK_TO_FRONT,
+    DRAW_FRONT_TO_BACK,
+    DRAW_DEPTH_PREPASS,
+    DRAW_INSTANCES,
+    DRAW_BENCH_MODE_COUNT,
+} DrawBenchMode;
+
+const char* const DRAW_BENCH_MODE_NAMES[DRAW_BENCH_MODE_COUNT] = {
+    "back to front", "front to back", "depth pre-pass", "instances",
+};
+
+#define DRAW_BENCH_FRAMES 240
+#define DRAW_BENCH_PITCH -15.0f
+#define DRAW_BENCH_INSTANCES_XZ 64 // instances in a layer of the cloud is this squared
+#define DRAW_BENCH_INSTANCES_Y 8
+
+// small blocks on a grid around the camera, refilled every frame like real instances
+void push_bench_instances(float time) {
+    for (int y = 0; y < DRAW_BENCH_INSTANCES_Y; y++) {
+        for (int z = 0; z < DRAW_BENCH_INSTANCES_XZ; z++) {
+            for (int x = 0; x < DRAW_BENCH_INSTANCES_XZ; x++) {
+                vec3 position = {
+                    pos[0] + x - DRAW_BENCH_INSTANCES_XZ / 2,
+                    pos[1] + y + 2,
+                    pos[2] + z - DRAW_BENCH_INSTANCES_XZ / 2,
+                };
+                push_instance(BLOCK_GRASS + (x + y + z) % 3, position, 0.4f, time + x * 0.1f, 1.0f);
+            }
+        }
+    }
+}
+
+// turns the camera a full circle from where it stands once per mode and times culling and drawing each frame to
+// the end of the gpu's work, vsync is off for the run, the instance mode includes writing the instances
+void run_draw_benchmark(GLFWwindow* window, mat4 projection, int frames) {
+    bool prepass = depth_prepass;
+    glfwSwapInterval(0);
+    VisibleChunks visible;
+    LatencyStats* stats = mem_calloc(MEM_TIMINGS, 1, sizeof(LatencyStats));
+    if (!stats) return;
+    for (int mode = 0; mode < DRAW_BENCH_MODE_COUNT; mode++) {
+        depth_prepass = mode == DRAW_DEPTH_PREPASS;
+        // the translucent pass keeps its own order in every mode so only the solid passes differ
+        solid_back_to_front = mode == DRAW_BACK_TO_FRONT;
+        for (int i = 0; i < frames; i++) {
+            float angle = glm_rad(360.0f * i / frames);
+            vec3 direction = {
+                cosf(angle) * cosf(glm_rad(DRAW_BENCH_PITCH)),
+                sinf(glm_rad(DRAW_BENCH_PITCH)),
+                sinf(angle) * cosf(glm_rad(DRAW_BENCH_PITCH)),
+            };
+            mat4 view;
+            vec3 target;
+            glm_vec3_add(pos, direction, target);
+            glm_lookat(pos, target, up, view);
+            update_camera(projection, view, pos);
+
+            double start = now_seconds();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            if (mode == DRAW_INSTANCES) {
+                begin_instances();
+                push_bench_instances(angle);
+            }
+            cull_chunks(world, pos, Camera.block.planes, &visible);
+            draw_chunks(&visible, pos);
+            glFinish();
+            latency_record(stats, now_seconds() - start);
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        latency_report(stdout, DRAW_BENCH_MODE_NAMES[mode], stats);
+    }
+    mem_free(MEM_TIMINGS, stats, sizeof(LatencyStats));
+    depth_prepass = prepass;
+    solid_back_to_front = false;
+    set_pacing(pacer.mode);
+}
+
+#define BENCH_SIZE_X 32
+#define BENCH_SIZE_Y 8
+#define BENCH_SIZE_Z 32
+#define BENCH_RAYS 100000
+#define BENCH_BODIES 4096
+#define BENCH_TICKS 60
+
+// headless scene for profiling and the pgo training run, needs no window or gl context
+int run_benchmark(int iterations) {
+    if (!init_blocks()) return 1;
+    JobPool jobs;
+    if (!job_pool_start(&jobs)) return 1;
+    double start = now_seconds();
     int width, height, channels;
-    unsigned char* pixels = get_atlas(&width, &height, &channels, 4);
+    unsigned char* pixels = get_atlas(&jobs, &width, &height, &channels, 4);
+    mem_free(MEM_TEXTURES, pixels, (size_t)width * height * channels);
+    double atlas_time = now_seconds() - start;
+
+    World* bench_world = new_World();
+    for(int x = 0; x < BENCH_SIZE_X; x++) {
+        for(int y = 0; y < BENCH_SIZE_Y; y++) {
+            for(int z = 0; z < BENCH_SIZE_Z; z++) {
+                world_set_block(bench_world, x, y, z, BLOCK_GRASS + (x + y + z) % 3);
+            }
+        }
+    }
+
+    size_t vertices = 0;
+    MeshBuffer buffer = new_MeshBuffer();
+    start = now_seconds();
+    for(int i = 0; i < iterations; i++) {
+        world_mark_all_dirty(bench_world);
+        Chunk* chunk;
+        while ((chunk = world_pop_dirty(bench_world))) {
+            reset_buffer(&buffer);
+            mesh_chunk(&buffer, bench_world, chunk);
+            vertices += buffer.vertices_len / VERTEX_FLOATS;
+        }
+    }
+    double mesh_time = now_seconds() - start;
+
+    size_t binary_vertices = 0;
+    start = now_seconds();
+    for(int i = 0; i < iterations; i++) {
+        world_mark_all_dirty(bench_world);
+        Chunk* chunk;
+        while ((chunk = world_pop_dirty(bench_world))) {
+            reset_buffer(&buffer);
+            mesh_chunk_binary(&buffer, bench_world, chunk);
+            binary_vertices += buffer.vertices_len / VERTEX_FLOATS;
+        }
+    }
+    double binary_time = now_seconds() - start;
+
+    // single block edits on the slab surface, time until every affected chunk is remeshed
+    srand(1);
+    start = now_seconds();
+    for(int i = 0; i < iterations; i++) {
+        int x = rand() % BENCH_SIZE_X, z = rand() % BENCH_SIZE_Z;
+        world_edit_block(bench_world, x, BENCH_SIZE_Y - 1, z, i % 2 ? BLOCK_DIRT : BLOCK_AIR);
+        Chunk* chunk;
+        while ((chunk = world_pop_dirty(bench_world))) {
+            reset_buffer(&buffer);
+            mesh_chunk(&buffer, bench_world, chunk);
+        }
+    }
+    double edit_time = now_seconds() - start;
+
+    size_t lod_vertices[LOD_COUNT] = {0};
+    start = now_seconds();
+    for(int i = 0; i < iterations; i++) {
+        for(int lod = 0; lod < LOD_COUNT; lod++) {
+            reset_buffer(&buffer);
+            mesh_chunk_lod(&buffer, bench_world, world_get_chunk(bench_world, 0, 0, 0), lod);
+            lod_vertices[lod] = buffer.vertices_len / VERTEX_FLOATS;
+        }
+    }
+    double lod_time = now_seconds() - start;
+
+    start = now_seconds();
+    for(int i = 0; i < iterations; i++) {
+        chunk_update_visibility(world_get_chunk(bench_world, 0, 0, 0));
+    }
+    double visibility_time = now_seconds() - start;
+
+    // full relight of the slab, then lamps placed on and taken off its surface
+    Lighter* lighter = new_Lighter(bench_world);
+    start = now_seconds();
+    light_world(lighter);
+    double light_world_time = now_seconds() - start;
+    srand(1);
+    start = now_seconds();
+    for(int i = 0; i < iterations; i++) {
+        int x = rand() % BENCH_SIZE_X, z = rand() % BENCH_SIZE_Z;
+        BlockId old_id = world_get_block(bench_world, x, BENCH_SIZE_Y, z);
+        world_set_block(bench_world, x, BENCH_SIZE_Y, z, old_id == BLOCK_LAMP ? BLOCK_AIR : BLOCK_LAMP);
+        light_block_changed(lighter, x, BENCH_SIZE_Y, z, old_id);
+    }
+    double light_edit_time = now_seconds() - start;
+    free_Lighter(lighter);
+    free_buffer(&buffer);
+
+    // the lit slab chunk packed and unpacked again
+    Chunk* cold = world_peek_chunk(bench_world, 0, 0, 0);
+    double pack_time = 0.0, unpack_time = 0.0;
+    size_t packed_size = 0;
+    for(int i = 0; i < iterations; i++) {
+        start = now_seconds();
+        chunk_compress(bench_world, cold);
+        pack_time += now_seconds() - start;
+        packed_size = cold->packed_size;
+        start = now_seconds();
+        world_touch_chunk(bench_world, cold);
+        unpack_time += now_seconds() - start;
+    }
+
+    // rays from above the slab in every direction, most of them miss and cross empty chunks
+    Ray* rays = malloc(sizeof(Ray) * BENCH_RAYS);
+    RayHit* hits = malloc(sizeof(RayHit) * BENCH_RAYS);
+    srand(1);
+    for(int i = 0; i < BENCH_RAYS; i++) {
+        rays[i] = (Ray){
+            .origin = { BENCH_SIZE_X / 2.0f, BENCH_SIZE_Y + 4.0f, BENCH_SIZE_Z / 2.0f },
+            .dir = { rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f },
+            .max_distance = 100.0f,
+        };
+    }
+    size_t ray_hits = 0;
+    start = now_seconds();
+    for(int i = 0; i < iterations; i++) {
+        raycast_batch(bench_world, rays, BENCH_RAYS, hits);
+    }
+    double ray_time = now_seconds() - start;
+    for(int i = 0; i < BENCH_RAYS; i++) ray_hits += hits[i].hit;
+    free(rays);
+    free(hits);
+
+    // falling and sliding boxes spread over the slab and the air around it
+    Body* bodies = malloc(sizeof(Body) * BENCH_BODIES);
+    for(int i = 0; i < BENCH_BODIES; i++) {
+        bodies[i] = (Body){
+            .center = { rand() % (BENCH_SIZE_X + 16) - 8.0f, BENCH_SIZE_Y + rand() % 16, rand() % (BENCH_SIZE_Z + 16) - 8.0f },
+            .half_extents = { 0.3f, 0.9f, 0.3f },
+            .velocity = { rand() % 9 - 4.0f, 0.0f, rand() % 9 - 4.0f },
+            .gravity = 20.0f,
+        };
+    }
+    start = now_seconds();
+    for(int i = 0; i < BENCH_TICKS; i++) {
+        physics_step(bench_world, bodies, BENCH_BODIES, 1.0f / 60.0f);
+    }
+    double physics_time = now_seconds() - start;
+    free(bodies);
+    free_World(bench_world);
+
+    printf("atlas: %.3f ms\n", atlas_time * 1000.0);
+    printf("mesh: %.3f ms per iteration, %zu vertices\n", mesh_time * 1000.0 / iterations, vertices / iterations);
+    printf("binary mesh: %.3f ms per iteration, %zu vertices\n", binary_time * 1000.0 / iterations, binary_vertices / iterations);
+    printf("edit: %.3f ms from edit to remeshed\n", edit_time * 1000.0 / iterations);
+    printf("lod: %.3f ms per iteration, %zu / %zu / %zu / %zu vertices at 1x / 2x / 4x / 8x\n", lod_time * 1000.0 / iterations,
+        lod_vertices[0], lod_vertices[1], lod_vertices[2], lod_vertices[3]);
+    printf("visibility: %.3f ms per chunk\n", visibility_time * 1000.0 / iterations);
+    printf("light: %.3f ms to light the slab, %.3f ms per lamp edit\n", light_world_time * 1000.0, light_edit_time * 1000.0 / iterations);
+    printf("compress: %.3f ms to pack, %.3f ms to unpack, %zu to %zu bytes\n", pack_time * 1000.0 / iterations,
+        unpack_time * 1000.0 / iterations, sizeof(ChunkVoxels), packed_size);
+    printf("raycast: %.1f ns per ray, %zu of %d hit\n", ray_time * 1e9 / ((double)iterations * BENCH_RAYS), ray_hits, BENCH_RAYS);
+    printf("physics: %.3f ms per tick for %d bodies\n", physics_time * 1000.0 / BENCH_TICKS, BENCH_BODIES);
+    printf("scratch: %.1f of %d kb high water\n", scratch_arena()->high_water / 1024.0, SCRATCH_SIZE / 1024);
+    job_pool_stop(&jobs);
+    free_scratch_arena();
+    mem_report(stdout);
+    return 0;
+}
+
+// ./main --bench [iterations]
+// ./main --draw-bench [frames]
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        int iterations = argc > 2 ? atoi(argv[2]) : 50;
+        return run_benchmark(iterations > 0 ? iterations : 1);
+    }
+    // --fps N caps the frame rate with sleep plus spin, --uncapped turns vsync off, --latency starts measuring,
+    // --prepass starts with the depth pre-pass on, --draw-bench renders a fixed turn in every draw order and exits
+    PacingMode pacing_mode = PACING_VSYNC;
+    int fps = PACING_DEFAULT_FPS;
+    int draw_bench_frames = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--uncapped") == 0) pacing_mode = PACING_UNCAPPED;
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            pacing_mode = PACING_CAPPED;
+            fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--latency") == 0) measure_latency = true;
+        else if (strcmp(argv[i], "--prepass") == 0) depth_prepass = true;
+        else if (strcmp(argv[i], "--draw-bench") == 0) {
+            draw_bench_frames = i + 1 < argc && atoi(argv[i + 1]) > 0 ? atoi(argv[++i]) : DRAW_BENCH_FRAMES;
+        }
+    }
+    pacer = new_FramePacer(pacing_mode, fps);
+
+    startup_profile_start();
+    double phase = now_seconds();
+    if (!init_blocks()) {
+        fprintf(stderr, "Failed to load the block table\n");
+        return -1;
+    }
+    startup_phase("block table", phase);
+    // embedded assets are followed by a '\0', shaders can be used in place
+    const char* vert_shader = (const char*)assets_shaders_vert_glsl_start;
+    const char* frag_shader = (const char*)assets_shaders_frag_glsl_start;
+    const char* geo_shader = (const char*)assets_shaders_geo_glsl_start;
+    // textures are decoded and the world is generated, lit and meshed on the job pool while the window and gl
+    // state are set up, the main thread only waits where it needs their results for gl
+    phase = now_seconds();
+    JobPool jobs;
+    if (!job_pool_start(&jobs)) {
+        fprintf(stderr, "Failed to start the job threads\n");
+        return -1;
+    }
+    // from here on failures go through startup_failed, which stops the threads started so far
+    TaskGraph startup = {0};
+    int light_task = -1, mesh_task = -1;
+    AtlasLoad atlas_load;
+    if (!start_atlas_load(&atlas_load, &jobs, 4)) {
+        fprintf(stderr, "Failed to load textures\n");
+        goto startup_failed;
+    }
+    player.center[1] = world_height_at(0, 0) + 1.5f;
+    glm_vec3_copy(player.center, pos);
+    pos[1] += EYE_OFFSET;
+    StartupMeshes* startup_meshes = mem_calloc(MEM_MESHES, 1, sizeof(StartupMeshes));
+    if (!startup_meshes) {
+        fprintf(stderr, "Failed to allocate startup meshes\n");
+        goto startup_failed;
+    }
+    glm_vec3_copy(pos, startup_meshes->eye);
+    int generate_task = task_add(&startup, "world generation", generate_world_task, NULL, 1, NULL, 0);
+    light_task = task_add(&startup, "lighting", light_world_task, NULL, 1, &generate_task, 1);
+    mesh_task = task_add(&startup, "meshing", mesh_chunk_task, startup_meshes, STARTUP_MESH_ITEMS, &light_task, 1);
+    if (!task_graph_start(&startup, &jobs)) {
+        fprintf(stderr, "Failed to start the startup tasks\n");
+        goto startup_failed;
+    }
+    startup_phase("queue startup jobs", phase);
+
+    phase = now_seconds();
     if (!glfwInit()) {
         fprintf(stderr, "Failed to init GLFW\n");
-        return -1;
+        goto startup_failed;
     }
+    startup_phase("glfw init", phase);
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // GL_ANY_SAMPLES_PASSED
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RED_BITS, 8);
     glfwWindowHint(GLFW_GREEN_BITS, 8);
     glfwWindowHint(GLFW_BLUE_BITS, 8);
     glfwWindowHint(GLFW_ALPHA_BITS, 8);
 
+    phase = now_seconds();
     GLFWmonitor* primary = glfwGetPrimaryMonitor();
     const GLFWvidmode* mode = glfwGetVideoMode(primary);
     set_size(mode->width, mode->height);
@@ -474,78 +2169,82 @@ int main(void) {
     GLFWwindow* window = glfwCreateWindow(mode->width, mode->height, "minceraft", primary, NULL);
     if (!window) {
         fprintf(stderr, "Failed to create GLFW window\n");
-        glfwTerminate();
-        return -1;
+        goto startup_failed;
     }
 
     glfwMakeContextCurrent(window);
+    set_pacing(pacer.mode);
     glfwSetKeyCallback(window, key_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    startup_phase("window", phase);
 
-
+    phase = now_seconds();
     int version = gladLoadGL(glfwGetProcAddress);
     if (!version) {
         fprintf(stderr, "Failed to init GLAD\n");
-        glfwTerminate();
-        return -1;
+        goto startup_failed;
     }
-
-    GLuint shaders = create_shader_program(vert_shader, frag_shader, geo_shader);
-    free(vert_shader);
-    free(frag_shader);
-    free(geo_shader);
-    if (!shaders) {
+    startup_phase("gl loader", phase);
+
+    phase = now_seconds();
+    Chunk_Programs.opaque = create_shader_program(vert_shader, frag_shader, geo_shader, NULL);
+    Chunk_Programs.cutout = create_shader_program(vert_shader, frag_shader, geo_shader, "#define ALPHA_TEST\n");
+    Chunk_Programs.depth = create_shader_program(vert_shader, frag_shader, geo_shader, "#define DEPTH_ONLY\n");
+    GLuint chunk_programs[2] = { Chunk_Programs.opaque, Chunk_Programs.cutout };
+    if (!chunk_programs[0] || !chunk_programs[1] || !Chunk_Programs.depth
+        || !bind_camera(chunk_programs[0]) || !bind_camera(chunk_programs[1]) || !bind_camera(Chunk_Programs.depth)) {
         fprintf(stderr, "Failed to create shader program\n");
-        glfwTerminate();
-        return -1;
+        goto startup_failed;
+    }
+    init_camera();
+    if (!init_occlusion()) {
+        fprintf(stderr, "Failed to create occlusion query shader program\n");
+        goto startup_failed;
+    }
+    if (!init_instances(frag_shader)) {
+        fprintf(stderr, "Failed to create instance shader program\n");
+        goto startup_failed;
     }
+    if (!init_sky()) {
+        fprintf(stderr, "Failed to create sky shader program\n");
+        goto startup_failed;
+    }
+    startup_phase("shaders", phase);
 
     MeshBuffer buffer = new_MeshBuffer();
-    createBlock(&buffer, Blocks.Cobbled_Stone_Block, (vec3){0, 0, 0});
-    createBlock(&buffer, Blocks.Dirt_Block, (vec3){2, 0, 0});
-    createBlock(&buffer, Blocks.Grass_Block, (vec3){0, 0, 2});
-    
-    GLuint VBO, VAO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    VisibleChunks visible;
 
-    glEnable(GL_BLEND);
+    // blending is only turned on for the translucent pass
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*buffer.vertices_limit, buffer.vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int)*buffer.indices_limit, buffer.indices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // texture coord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glBindVertexArray(0);
     glEnable(GL_CULL_FACE);      // Enable face culling
 
 
-    // Setup projection matrix
+    // Setup projection matrix, rebuilt only when the aspect ratio changes
     mat4 proj;
+    float proj_aspect = 0.0f;
     float fov = glm_rad(45.0f);
     float near = 0.1f;
-    float far = 100.0f;
+    float far = 400.0f; // distant chunks are meshed at a lower level of detail
 
-    glUseProgram(shaders);
-    GLuint projLoc = glGetUniformLocation(shaders, "projection");
-    GLuint viewLoc = glGetUniformLocation(shaders, "view");
-    glUniform2f(glGetUniformLocation(shaders, "screenSize"), (float)WIDTH, (float)HEIGHT);
+    // the instance program shares the chunk fragment shader and its uniforms
+    GLuint textured_programs[3] = { chunk_programs[0], chunk_programs[1], Instances.program };
+    for (int i = 0; i < 3; i++) {
+        glUseProgram(textured_programs[i]);
+        glUniform2f(glGetUniformLocation(textured_programs[i], "screenSize"), (float)WIDTH, (float)HEIGHT);
+    }
 
     glEnable(GL_DEPTH_TEST);
+    phase = now_seconds();
+    int width, height, channels;
+    unsigned char* pixels = finish_atlas_load(&atlas_load, &jobs, &width, &height, &channels);
+    if (!pixels) {
+        fprintf(stderr, "Failed to load textures\n");
+        goto startup_failed;
+    }
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
@@ -562,45 +2261,135 @@ int main(void) {
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
     glGenerateMipmap(GL_TEXTURE_2D);
-
-    glUniform1i(glGetUniformLocation(shaders, "texture1"), 0);
+    // the mip chain adds about a third on top of the base level
+    size_t texture_bytes = (size_t)width * height * 4 * 4 / 3;
+    mem_track(MEM_TEXTURES, texture_bytes);
+
+    float tiles[MAX_TILES][4] = {0};
+    for (int i = 0; i < TEXTURE_COUNT; i++) {
+        UV* uv = &Texture_UVs[i];
+        tiles[i][0] = uv->umin;
+        tiles[i][1] = uv->vmin;
+        tiles[i][2] = uv->umax - uv->umin;
+        tiles[i][3] = uv->vmax - uv->vmin;
+    }
+    for (int i = 0; i < 3; i++) {
+        glUseProgram(textured_programs[i]);
+        glUniform1i(glGetUniformLocation(textured_programs[i], "texture1"), 0);
+        glUniform4fv(glGetUniformLocation(textured_programs[i], "tiles"), MAX_TILES, (const float*)tiles);
+    }
 
 
     // free pixel data after uploading
-    free(pixels);
+    mem_free(MEM_TEXTURES, pixels, (size_t)width * height * channels);
+    startup_phase("texture upload", phase);
+
+    phase = now_seconds();
+    if (!task_wait(&startup, mesh_task)) {
+        fprintf(stderr, "Failed to build the world\n");
+        goto startup_failed;
+    }
+    startup_phase("wait for meshing", phase);
+    phase = now_seconds();
+    upload_startup_meshes(startup_meshes);
+    mem_free(MEM_MESHES, startup_meshes, sizeof(StartupMeshes));
+    free_task_graph(&startup);
+    startup_phase("mesh upload", phase);
+    bool first_frame = true;
+
+    if (draw_bench_frames) {
+        glm_perspective(fov, (float)WIDTH / (float)HEIGHT, near, far, proj);
+        glClearColor(0.0f, 0.56, 0.78f, 1.0f);
+        run_draw_benchmark(window, proj, draw_bench_frames);
+        glfwSetWindowShouldClose(window, GL_TRUE);
+    }
 
     while (!glfwWindowShouldClose(window)) {
+        pacer_wait(&pacer);
         float aspect = (float)WIDTH / (float)HEIGHT;
-        glm_perspective(fov, aspect, near, far, proj);
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, (const float*)proj);
+        if (aspect != proj_aspect) {
+            glm_perspective(fov, aspect, near, far, proj);
+            proj_aspect = aspect;
+        }
         glfwPollEvents();
         update(window);
+        light_engine_collect(&light_engine, world);
+        update_chunk_lods(world, pos);
+        // meshing reads light, rather than wait for the light thread the chunks stay queued for the next frame
+        if (pthread_mutex_trylock(&light_engine.world_lock) == 0) {
+            remesh_dirty_chunks(world, &buffer, pos);
+            debris_sample_light(&debris, world);
+            world_compress_cold(world, WORLD_HOT_CHUNKS);
+            pthread_mutex_unlock(&light_engine.world_lock);
+        }
+        // polled once more right before the view is built so mouse movement during the work above still makes it
+        // into this frame, anything else it picks up is handled by the next update
+        glfwPollEvents();
+        double frame_input = input_time;
+        double frame_sample = now_seconds();
+        input_time = 0;
         mat4 view;
         vec3 target;
         glm_vec3_add(pos, front, target);
         glm_lookat(pos, target, up, view);
-
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (const float*)view);
-
+        update_camera(proj, view, pos);
 
         glClearColor(0.0f, 0.56, 0.78f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, buffer.indices_len, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        begin_instances();
+        push_debris_instances();
+        push_place_preview();
+        cull_chunks(world, pos, Camera.block.planes, &visible);
+        draw_chunks(&visible, pos);
 
         glfwSwapBuffers(window);
+        if (measure_latency) {
+            glFinish(); // the swap only queues the frame, wait until the gpu is done with it
+            double now = now_seconds();
+            if (frame_input) latency_record(&input_latency, now - frame_input);
+            latency_record(&sample_latency, now - frame_sample);
+        }
+        if (first_frame) {
+            startup_report(stdout, now_seconds());
+            first_frame = false;
+        }
+    }
+    if (measure_latency) {
+        latency_report(stdout, "input to swap", &input_latency);
+        latency_report(stdout, "sample to swap", &sample_latency);
     }
     free_buffer(&buffer);
-
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaders);
+    free_chunk_meshes();
+    free_occlusion();
+    free_instances();
+    free_sky();
+    free_camera();
+    light_engine_stop(&light_engine);
+    free_World(world);
+
+    glDeleteTextures(1, &texture);
+    mem_track(MEM_TEXTURES, -(ptrdiff_t)texture_bytes);
+    glDeleteProgram(Chunk_Programs.opaque);
+    glDeleteProgram(Chunk_Programs.cutout);
+    glDeleteProgram(Chunk_Programs.depth);
+    job_pool_stop(&jobs);
+    free_scratch_arena();
+    mem_report(stdout);
 
     glfwTerminate();
 
     return 0;
+
+startup_failed:
+    // the graph is waited on before the pool stops, the light thread is running once the lighting task succeeded
+    if (startup.items) {
+        task_wait(&startup, mesh_task);
+        if (task_wait(&startup, light_task)) light_engine_stop(&light_engine);
+        free_task_graph(&startup);
+    }
+    job_pool_stop(&jobs);
+    glfwTerminate();
+    return -1;
 }
 
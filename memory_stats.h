@@ -0,0 +1,112 @@
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+// bytes in use per subsystem, callers pass the size they allocated so no headers are added to blocks
+// gpu memory is never allocated here, it's reported with mem_track when buffers are sized or deleted
+typedef enum {
+    MEM_VOXELS,
+    MEM_MESHES,      // cpu side vertex and index data
+    MEM_GPU_BUFFERS,
+    MEM_TEXTURES,    // decoded images, the atlas and its gpu copy
+    MEM_JOBS,        // work queues of background threads
+    MEM_TIMINGS,     // frame time samples of the benchmarks
+    MEM_TAG_COUNT,
+} MemTag;
+
+const char* const MEM_TAG_NAMES[MEM_TAG_COUNT] = {
+    "voxels", "meshes", "gpu buffers", "textures", "job queues", "timings",
+};
+
+typedef struct {
+    size_t current;     // bytes
+    size_t peak;
+    size_t live;        // allocations not freed yet
+    size_t allocations; // allocations ever made
+} MemStats;
+
+// updated from every thread
+struct {
+    atomic_size_t current, peak, live, allocations;
+} Memory[MEM_TAG_COUNT];
+
+void mem_track(MemTag tag, ptrdiff_t bytes) {
+    size_t current = atomic_fetch_add(&Memory[tag].current, (size_t)bytes) + (size_t)bytes;
+    size_t peak = atomic_load(&Memory[tag].peak);
+    while (current > peak && !atomic_compare_exchange_weak(&Memory[tag].peak, &peak, current)) {}
+}
+
+void mem_track_alloc(MemTag tag, size_t bytes) {
+    atomic_fetch_add(&Memory[tag].live, 1);
+    atomic_fetch_add(&Memory[tag].allocations, 1);
+    mem_track(tag, bytes);
+}
+
+void mem_track_free(MemTag tag, size_t bytes) {
+    atomic_fetch_sub(&Memory[tag].live, 1);
+    mem_track(tag, -(ptrdiff_t)bytes);
+}
+
+void* mem_malloc(MemTag tag, size_t bytes) {
+    void* ptr = malloc(bytes);
+    if (ptr) mem_track_alloc(tag, bytes);
+    return ptr;
+}
+
+void* mem_calloc(MemTag tag, size_t count, size_t size) {
+    void* ptr = calloc(count, size);
+    if (ptr) mem_track_alloc(tag, count * size);
+    return ptr;
+}
+
+// alignment must be a power of two, bytes is rounded up to a multiple of it as aligned_alloc wants
+void* mem_aligned_alloc(MemTag tag, size_t alignment, size_t bytes) {
+    bytes = (bytes + alignment - 1) & ~(alignment - 1);
+    void* ptr = aligned_alloc(alignment, bytes);
+    if (ptr) mem_track_alloc(tag, bytes);
+    return ptr;
+}
+
+// old_bytes is 0 when ptr is NULL, on failure ptr stays valid and keeps being counted
+void* mem_realloc(MemTag tag, void* ptr, size_t old_bytes, size_t bytes) {
+    void* result = realloc(ptr, bytes);
+    if (!result) return NULL;
+    if (!ptr) mem_track_alloc(tag, bytes);
+    else mem_track(tag, (ptrdiff_t)bytes - (ptrdiff_t)old_bytes);
+    return result;
+}
+
+void mem_free(MemTag tag, void* ptr, size_t bytes) {
+    if (!ptr) return;
+    free(ptr);
+    mem_track_free(tag, bytes);
+}
+
+void mem_aligned_free(MemTag tag, void* ptr, size_t alignment, size_t bytes) {
+    mem_free(tag, ptr, (bytes + alignment - 1) & ~(alignment - 1));
+}
+
+MemStats mem_stats(MemTag tag) {
+    return (MemStats){
+        .current = atomic_load(&Memory[tag].current),
+        .peak = atomic_load(&Memory[tag].peak),
+        .live = atomic_load(&Memory[tag].live),
+        .allocations = atomic_load(&Memory[tag].allocations),
+    };
+}
+
+void mem_report(FILE* out) {
+    fprintf(out, "%-12s %12s %12s %8s %8s\n", "memory", "current kb", "peak kb", "live", "allocs");
+    size_t current = 0, peak = 0;
+    for (int tag = 0; tag < MEM_TAG_COUNT; tag++) {
+        MemStats stats = mem_stats(tag);
+        fprintf(out, "%-12s %12.1f %12.1f %8zu %8zu\n", MEM_TAG_NAMES[tag],
+            stats.current / 1024.0, stats.peak / 1024.0, stats.live, stats.allocations);
+        current += stats.current;
+        peak += stats.peak;
+    }
+    // peaks of different subsystems can be at different times, their sum is an upper bound
+    fprintf(out, "%-12s %12.1f %12.1f\n", "total", current / 1024.0, peak / 1024.0);
+}
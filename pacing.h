@@ -0,0 +1,88 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "startup.h"
+
+// how frames are spaced, vsync waits in the swap, capped waits before the frame starts so input is sampled
+// as close to the swap as the cap allows
+typedef enum {
+    PACING_VSYNC,
+    PACING_UNCAPPED,
+    PACING_CAPPED,
+    PACING_MODE_COUNT,
+} PacingMode;
+
+const char* const PACING_MODE_NAMES[PACING_MODE_COUNT] = { "vsync", "uncapped", "capped" };
+
+// the os wakes a sleeping thread up to a millisecond or so late, the last stretch before the deadline is spun
+#define PACING_SPIN_SECONDS 0.002
+#define PACING_DEFAULT_FPS 120
+
+typedef struct {
+    PacingMode mode;
+    double frame_seconds; // target frame time in capped mode
+    double deadline;      // when the next capped frame may start
+} FramePacer;
+
+FramePacer new_FramePacer(PacingMode mode, int fps) {
+    return (FramePacer){
+        .mode = mode,
+        .frame_seconds = 1.0 / (fps > 0 ? fps : PACING_DEFAULT_FPS),
+    };
+}
+
+// blocks until the next capped frame may start, returns right away in the other modes
+void pacer_wait(FramePacer* pacer) {
+    if (pacer->mode != PACING_CAPPED) return;
+    double now = now_seconds();
+    // after a long frame the schedule starts over instead of rushing frames out to catch up
+    if (pacer->deadline < now - pacer->frame_seconds) pacer->deadline = now;
+    double sleep_until = pacer->deadline - PACING_SPIN_SECONDS;
+    if (sleep_until > now) {
+        struct timespec ts = { (time_t)sleep_until, (long)((sleep_until - (time_t)sleep_until) * 1e9) };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    while (now_seconds() < pacer->deadline);
+    pacer->deadline += pacer->frame_seconds;
+}
+
+// input-to-swap times in the latency measurement mode, from when an input event was handled to the swap of
+// the first frame built after it
+#define LATENCY_MAX_SAMPLES 4096
+
+typedef struct {
+    double samples[LATENCY_MAX_SAMPLES]; // ring buffer, a long run keeps its latest samples
+    size_t count;
+} LatencyStats;
+
+void latency_record(LatencyStats* stats, double seconds) {
+    stats->samples[stats->count % LATENCY_MAX_SAMPLES] = seconds;
+    stats->count++;
+}
+
+int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+double latency_percentile(LatencyStats* stats, double percentile) {
+    size_t index = (size_t)(percentile / 100.0 * (stats->count - 1) + 0.5);
+    return stats->samples[index];
+}
+
+// sorts the samples and clears the stats
+void latency_report(FILE* out, const char* name, LatencyStats* stats) {
+    if (stats->count > LATENCY_MAX_SAMPLES) stats->count = LATENCY_MAX_SAMPLES;
+    if (stats->count == 0) {
+        fprintf(out, "%-16s no samples\n", name);
+        return;
+    }
+    qsort(stats->samples, stats->count, sizeof(double), compare_double);
+    fprintf(out, "%-16s %6zu samples, ms min %.2f p50 %.2f p95 %.2f p99 %.2f max %.2f\n", name, stats->count,
+        stats->samples[0] * 1000, latency_percentile(stats, 50) * 1000, latency_percentile(stats, 95) * 1000,
+        latency_percentile(stats, 99) * 1000, stats->samples[stats->count - 1] * 1000);
+    stats->count = 0;
+}
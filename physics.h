@@ -0,0 +1,187 @@
+#pragma once
+#include <math.h>
+#include <cglm/cglm.h>
+#include "world.h"
+
+// axis aligned box that moves through the world and stops at solid blocks
+typedef struct {
+    vec3 center;
+    vec3 half_extents;
+    vec3 velocity; // blocks per second, used by physics_step
+    float gravity; // blocks per second squared, 0 for flying bodies
+    bool on_ground;
+} Body;
+
+// largest move resolved against one gathered region, longer moves are split up
+#define PHYSICS_MAX_STEP 4.0f
+#define PHYSICS_REGION_SIZE 16
+// longest span of a box and its move along an axis, the cells it touches and a block of margin on each side fit
+// the region with half a block to spare for rounding, bodies wider than that aren't moved at all rather than
+// passing through whatever is left outside the region
+#define PHYSICS_MAX_SWEEP (PHYSICS_REGION_SIZE - 3.5f)
+#define PHYSICS_EPSILON 1e-4f
+
+// solid flags of every block the move can touch, gathered with one lookup per chunk
+typedef struct {
+    int min[3];
+    int size[3];
+    bool solid[PHYSICS_REGION_SIZE * PHYSICS_REGION_SIZE * PHYSICS_REGION_SIZE];
+} SolidRegion;
+
+#define REGION_INDEX(r, x, y, z) ((((y) * (r)->size[2]) + (z)) * (r)->size[0] + (x))
+
+// block cell a coordinate falls in, block b spans [b - 0.5, b + 0.5]
+int block_cell(float v) {
+    return (int)floorf(v + 0.5f);
+}
+
+void gather_solid_region(World* world, SolidRegion* region, const int min[3], const int max[3]) {
+    for (int a = 0; a < 3; a++) {
+        region->min[a] = min[a];
+        region->size[a] = max[a] - min[a] + 1;
+    }
+    for (int cy = BLOCK_TO_CHUNK(min[1]); cy <= BLOCK_TO_CHUNK(max[1]); cy++) {
+        for (int cz = BLOCK_TO_CHUNK(min[2]); cz <= BLOCK_TO_CHUNK(max[2]); cz++) {
+            for (int cx = BLOCK_TO_CHUNK(min[0]); cx <= BLOCK_TO_CHUNK(max[0]); cx++) {
+                Chunk* chunk = world_get_chunk(world, cx, cy, cz);
+                bool empty = !chunk || chunk->solid_count == 0;
+                // part of the region inside this chunk, in block coordinates
+                int x0 = cx * CHUNK_SIZE > min[0] ? cx * CHUNK_SIZE : min[0];
+                int y0 = cy * CHUNK_SIZE > min[1] ? cy * CHUNK_SIZE : min[1];
+                int z0 = cz * CHUNK_SIZE > min[2] ? cz * CHUNK_SIZE : min[2];
+                int x1 = cx * CHUNK_SIZE + CHUNK_MASK < max[0] ? cx * CHUNK_SIZE + CHUNK_MASK : max[0];
+                int y1 = cy * CHUNK_SIZE + CHUNK_MASK < max[1] ? cy * CHUNK_SIZE + CHUNK_MASK : max[1];
+                int z1 = cz * CHUNK_SIZE + CHUNK_MASK < max[2] ? cz * CHUNK_SIZE + CHUNK_MASK : max[2];
+                for (int y = y0; y <= y1; y++) {
+                    for (int z = z0; z <= z1; z++) {
+                        bool* row = &region->solid[REGION_INDEX(region, x0 - min[0], y - min[1], z - min[2])];
+                        if (empty) {
+                            memset(row, 0, x1 - x0 + 1);
+                            continue;
+                        }
+                        const BlockId* blocks = &chunk->blocks[CHUNK_INDEX(BLOCK_TO_LOCAL(x0), BLOCK_TO_LOCAL(y), BLOCK_TO_LOCAL(z))];
+                        for (int x = 0; x <= x1 - x0; x++) {
+                            row[x] = Blocks.solid[blocks[x]];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool region_solid(SolidRegion* region, int axis, int along, int u, int v) {
+    int p[3];
+    p[axis] = along;
+    p[(axis + 1) % 3] = u;
+    p[(axis + 2) % 3] = v;
+    for (int a = 0; a < 3; a++) {
+        if ((unsigned)(p[a] - region->min[a]) >= (unsigned)region->size[a]) return false;
+    }
+    return region->solid[REGION_INDEX(region, p[0] - region->min[0], p[1] - region->min[1], p[2] - region->min[2])];
+}
+
+// moves the box along one axis until it touches a solid block, returns how far it moved
+float sweep_axis(SolidRegion* region, vec3 box_min, vec3 box_max, int axis, float d) {
+    if (d == 0.0f) return 0.0f;
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    int u0 = block_cell(box_min[u] + PHYSICS_EPSILON), u1 = block_cell(box_max[u] - PHYSICS_EPSILON);
+    int v0 = block_cell(box_min[v] + PHYSICS_EPSILON), v1 = block_cell(box_max[v] - PHYSICS_EPSILON);
+    if (d > 0.0f) {
+        // first block whose low face is at or past the box's high face
+        for (int b = (int)ceilf(box_max[axis] + 0.5f - PHYSICS_EPSILON); b - 0.5f < box_max[axis] + d; b++) {
+            for (int bu = u0; bu <= u1; bu++) {
+                for (int bv = v0; bv <= v1; bv++) {
+                    if (region_solid(region, axis, b, bu, bv)) {
+                        d = fmaxf(0.0f, (b - 0.5f) - box_max[axis]);
+                        goto done;
+                    }
+                }
+            }
+        }
+    } else {
+        for (int b = (int)floorf(box_min[axis] - 0.5f + PHYSICS_EPSILON); b + 0.5f > box_min[axis] + d; b--) {
+            for (int bu = u0; bu <= u1; bu++) {
+                for (int bv = v0; bv <= v1; bv++) {
+                    if (region_solid(region, axis, b, bu, bv)) {
+                        d = fminf(0.0f, (b + 0.5f) - box_min[axis]);
+                        goto done;
+                    }
+                }
+            }
+        }
+    }
+done:
+    box_min[axis] += d;
+    box_max[axis] += d;
+    return d;
+}
+
+// moves body by motion, y first then x then z, each axis stops at the first solid block it meets
+// returns which axes were blocked as bits 1 << axis
+int physics_move(World* world, Body* body, vec3 motion) {
+    int steps = 1;
+    for (int a = 0; a < 3; a++) {
+        // a sub step plus the box has to fit the gathered region on every axis
+        float limit = fminf(PHYSICS_MAX_STEP, PHYSICS_MAX_SWEEP - 2.0f * body->half_extents[a]);
+        if (limit <= 0.0f) return 7; // too big for any region, blocked on every axis
+        int axis_steps = (int)ceilf(fabsf(motion[a]) / limit);
+        if (axis_steps > steps) steps = axis_steps;
+    }
+    vec3 step;
+    glm_vec3_scale(motion, 1.0f / steps, step);
+
+    int blocked = 0;
+    SolidRegion region;
+    for (int i = 0; i < steps; i++) {
+        vec3 box_min, box_max;
+        glm_vec3_sub(body->center, body->half_extents, box_min);
+        glm_vec3_add(body->center, body->half_extents, box_max);
+        // every block the box can touch on the way, start and end box together
+        int min[3], max[3];
+        for (int a = 0; a < 3; a++) {
+            min[a] = block_cell(fminf(box_min[a], box_min[a] + step[a])) - 1;
+            max[a] = block_cell(fmaxf(box_max[a], box_max[a] + step[a])) + 1;
+        }
+        gather_solid_region(world, &region, min, max);
+
+        const int order[3] = { 1, 0, 2 };
+        for (int j = 0; j < 3; j++) {
+            int a = order[j];
+            float moved = sweep_axis(&region, box_min, box_max, a, step[a]);
+            if (moved != step[a]) {
+                blocked |= 1 << a;
+                step[a] = 0.0f; // don't keep pushing into the wall on later sub steps
+            }
+        }
+        for (int a = 0; a < 3; a++) {
+            body->center[a] = (box_min[a] + box_max[a]) * 0.5f;
+        }
+    }
+    if (motion[1] < 0.0f) body->on_ground = blocked & (1 << 1);
+    else if (motion[1] > 0.0f) body->on_ground = false;
+    return blocked;
+}
+
+// integrates gravity and velocity of count bodies over dt seconds, blocked velocity components are zeroed
+void physics_step(World* world, Body* bodies, size_t count, float dt) {
+    for (size_t i = 0; i < count; i++) {
+        Body* body = &bodies[i];
+        body->velocity[1] -= body->gravity * dt;
+        vec3 motion;
+        glm_vec3_scale(body->velocity, dt, motion);
+        int blocked = physics_move(world, body, motion);
+        for (int a = 0; a < 3; a++) {
+            if (blocked & (1 << a)) body->velocity[a] = 0.0f;
+        }
+    }
+}
+
+bool body_intersects_block(Body* body, int x, int y, int z) {
+    int block[3] = { x, y, z };
+    for (int a = 0; a < 3; a++) {
+        if (body->center[a] + body->half_extents[a] <= block[a] - 0.5f + PHYSICS_EPSILON) return false;
+        if (body->center[a] - body->half_extents[a] >= block[a] + 0.5f - PHYSICS_EPSILON) return false;
+    }
+    return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "memory_stats.h"
+
+// fixed size items carved out of big slabs, freed items go on a free list and are handed out again before
+// any new slab is allocated, slabs are returned to the system by pool_trim once none of their items is live
+// every item is preceded by a pointer to its slab so alloc and free find the slab's live count without a search
+typedef struct PoolSlab {
+    struct PoolSlab* next;
+    size_t live;
+} PoolSlab;
+
+typedef struct {
+    size_t item_size;
+    size_t items_per_slab;
+    MemTag tag;
+    PoolSlab* slabs;
+    void* free_list; // each free item starts with a pointer to the next one
+    size_t capacity; // items in all slabs
+    size_t live;
+} Pool;
+
+// items are aligned to POOL_ALIGN, the slab and item headers are padded to keep them so
+#define POOL_ALIGN 64
+#define POOL_SLAB_HEADER ((sizeof(PoolSlab) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1))
+#define POOL_ITEM_HEADER ((sizeof(PoolSlab*) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1))
+
+Pool new_Pool(size_t item_size, size_t items_per_slab, MemTag tag) {
+    if (item_size < sizeof(void*)) item_size = sizeof(void*);
+    item_size = (item_size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+    return (Pool){
+        .item_size = item_size,
+        .items_per_slab = items_per_slab,
+        .tag = tag,
+    };
+}
+
+// distance between two items in a slab, header included
+size_t pool_stride(Pool* pool) {
+    return POOL_ITEM_HEADER + pool->item_size;
+}
+
+size_t pool_slab_bytes(Pool* pool) {
+    return POOL_SLAB_HEADER + pool_stride(pool) * pool->items_per_slab;
+}
+
+bool pool_grow(Pool* pool) {
+    PoolSlab* slab = mem_aligned_alloc(pool->tag, POOL_ALIGN, pool_slab_bytes(pool));
+    if (!slab) return false;
+    slab->next = pool->slabs;
+    slab->live = 0;
+    pool->slabs = slab;
+    // pushed back to front so items come out in address order
+    unsigned char* items = (unsigned char*)slab + POOL_SLAB_HEADER;
+    for (size_t i = pool->items_per_slab; i-- > 0;) {
+        unsigned char* header = items + i * pool_stride(pool);
+        *(PoolSlab**)header = slab;
+        void* item = header + POOL_ITEM_HEADER;
+        *(void**)item = pool->free_list;
+        pool->free_list = item;
+    }
+    pool->capacity += pool->items_per_slab;
+    return true;
+}
+
+// makes sure count items can be live without allocating another slab
+bool pool_reserve(Pool* pool, size_t count) {
+    while (pool->capacity < count) {
+        if (!pool_grow(pool)) return false;
+    }
+    return true;
+}
+
+PoolSlab* pool_slab_of(void* item) {
+    return *(PoolSlab**)((unsigned char*)item - POOL_ITEM_HEADER);
+}
+
+// zeroed item, NULL if a new slab was needed and couldn't be allocated
+void* pool_alloc(Pool* pool) {
+    if (!pool->free_list && !pool_grow(pool)) return NULL;
+    void* item = pool->free_list;
+    pool->free_list = *(void**)item;
+    pool->live++;
+    pool_slab_of(item)->live++;
+    memset(item, 0, pool->item_size);
+    return item;
+}
+
+void pool_free(Pool* pool, void* item) {
+    if (!item) return;
+    *(void**)item = pool->free_list;
+    pool->free_list = item;
+    pool->live--;
+    pool_slab_of(item)->live--;
+}
+
+// live count of the slabs pool_trim is about to free
+#define POOL_RELEASED SIZE_MAX
+
+// frees the slabs without live items but keeps at least keep items of capacity
+void pool_trim(Pool* pool, size_t keep) {
+    PoolSlab* released = NULL;
+    for (PoolSlab** link = &pool->slabs; *link;) {
+        PoolSlab* slab = *link;
+        if (slab->live == 0 && pool->capacity - pool->items_per_slab >= keep) {
+            *link = slab->next;
+            slab->next = released;
+            slab->live = POOL_RELEASED;
+            released = slab;
+            pool->capacity -= pool->items_per_slab;
+        } else {
+            link = &slab->next;
+        }
+    }
+    if (!released) return;
+    // drop the released slabs' items from the free list, keeping the order of the rest
+    void** link = &pool->free_list;
+    while (*link) {
+        if (pool_slab_of(*link)->live == POOL_RELEASED) *link = *(void**)*link;
+        else link = (void**)*link;
+    }
+    while (released) {
+        PoolSlab* next = released->next;
+        mem_aligned_free(pool->tag, released, POOL_ALIGN, pool_slab_bytes(pool));
+        released = next;
+    }
+}
+
+// frees every slab, items still live become invalid
+void free_Pool(Pool* pool) {
+    while (pool->slabs) {
+        PoolSlab* next = pool->slabs->next;
+        mem_aligned_free(pool->tag, pool->slabs, POOL_ALIGN, pool_slab_bytes(pool));
+        pool->slabs = next;
+    }
+    pool->free_list = NULL;
+    pool->capacity = 0;
+    pool->live = 0;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <math.h>
+#include <limits.h>
+#include <cglm/cglm.h>
+#include "world.h"
+
+typedef struct {
+    vec3 origin;
+    vec3 dir;
+    float max_distance;
+} Ray;
+
+typedef struct {
+    bool hit;
+    BlockId id;
+    int block[3];
+    Face face; // face the ray entered the block through, FACE_NONE if it started inside it
+    float distance;
+} RayHit;
+
+// Amanatides & Woo grid traversal, voxels are blocks so cell v spans [v - 0.5, v + 0.5]
+typedef struct {
+    int voxel[3];
+    int step[3];
+    float t_max[3];   // ray distance at which the next boundary on each axis is crossed
+    float t_delta[3]; // ray distance between two boundaries on each axis
+} Dda;
+
+void dda_init(Dda* dda, vec3 origin, vec3 dir) {
+    for (int a = 0; a < 3; a++) {
+        float p = origin[a] + 0.5f;
+        dda->voxel[a] = (int)floorf(p);
+        if (dir[a] > 0.0f) {
+            dda->step[a] = 1;
+            dda->t_delta[a] = 1.0f / dir[a];
+            dda->t_max[a] = (dda->voxel[a] + 1 - p) * dda->t_delta[a];
+        } else if (dir[a] < 0.0f) {
+            dda->step[a] = -1;
+            dda->t_delta[a] = -1.0f / dir[a];
+            dda->t_max[a] = (p - dda->voxel[a]) * dda->t_delta[a];
+        } else {
+            dda->step[a] = 0;
+            dda->t_delta[a] = INFINITY;
+            dda->t_max[a] = INFINITY;
+        }
+    }
+}
+
+// moves to the next voxel, returns the distance it was entered at
+float dda_step(Dda* dda, int* axis) {
+    int a = dda->t_max[0] < dda->t_max[1]
+        ? (dda->t_max[0] < dda->t_max[2] ? 0 : 2)
+        : (dda->t_max[1] < dda->t_max[2] ? 1 : 2);
+    float t = dda->t_max[a];
+    dda->voxel[a] += dda->step[a];
+    dda->t_max[a] += dda->t_delta[a];
+    *axis = a;
+    return t;
+}
+
+// moves to the first voxel outside the aligned cell of 1 << shift voxels the ray is in,
+// same result as calling dda_step until the cell is left but without visiting every voxel
+float dda_skip(Dda* dda, int shift, int* axis) {
+    int size = 1 << shift;
+    int crossings[3];
+    float exit_t[3];
+    for (int a = 0; a < 3; a++) {
+        int lo = dda->voxel[a] & ~(size - 1);
+        if (dda->step[a] > 0) {
+            crossings[a] = lo + size - dda->voxel[a];
+        } else if (dda->step[a] < 0) {
+            crossings[a] = dda->voxel[a] - lo + 1;
+        } else {
+            crossings[a] = 0;
+            exit_t[a] = INFINITY;
+            continue;
+        }
+        exit_t[a] = dda->t_max[a] + (crossings[a] - 1) * dda->t_delta[a];
+    }
+    int e = exit_t[0] < exit_t[1]
+        ? (exit_t[0] < exit_t[2] ? 0 : 2)
+        : (exit_t[1] < exit_t[2] ? 1 : 2);
+    float t = exit_t[e];
+    for (int a = 0; a < 3; a++) {
+        int n;
+        if (a == e) {
+            n = crossings[a];
+        } else if (dda->step[a] == 0 || dda->t_max[a] > t) {
+            n = 0;
+        } else {
+            // boundaries crossed before the exit, the ray can't leave the cell on this axis
+            n = (int)((t - dda->t_max[a]) / dda->t_delta[a]) + 1;
+            if (n > crossings[a] - 1) n = crossings[a] - 1;
+        }
+        if (n == 0) continue; // t_delta is infinite on axes the ray doesn't move along
+        dda->voxel[a] += dda->step[a] * n;
+        dda->t_max[a] += dda->t_delta[a] * n;
+    }
+    *axis = e;
+    return t;
+}
+
+// first non air block along the ray, dir doesn't need to be normalized
+RayHit raycast(World* world, vec3 origin, vec3 dir, float max_distance) {
+    RayHit result = { .hit = false, .id = BLOCK_AIR, .face = FACE_NONE, .distance = max_distance };
+    float len = glm_vec3_norm(dir);
+    if (len == 0.0f) return result;
+    vec3 d;
+    glm_vec3_scale(dir, 1.0f / len, d);
+
+    Dda dda;
+    dda_init(&dda, origin, d);
+    float t = 0.0f;
+    int axis = -1;
+    Chunk* chunk = NULL;
+    int chunk_pos[3] = { INT_MIN, INT_MIN, INT_MIN };
+    while (t <= max_distance) {
+        int cx = BLOCK_TO_CHUNK(dda.voxel[0]);
+        int cy = BLOCK_TO_CHUNK(dda.voxel[1]);
+        int cz = BLOCK_TO_CHUNK(dda.voxel[2]);
+        if (cx != chunk_pos[0] || cy != chunk_pos[1] || cz != chunk_pos[2]) {
+            // the brick masks are enough to find a hit, the chunk is only unpacked for its id
+            chunk = world_peek_chunk(world, cx, cy, cz);
+            chunk_pos[0] = cx;
+            chunk_pos[1] = cy;
+            chunk_pos[2] = cz;
+        }
+        if (!chunk || chunk->solid_count == 0) {
+            t = dda_skip(&dda, CHUNK_SHIFT, &axis);
+            continue;
+        }
+        int lx = BLOCK_TO_LOCAL(dda.voxel[0]);
+        int ly = BLOCK_TO_LOCAL(dda.voxel[1]);
+        int lz = BLOCK_TO_LOCAL(dda.voxel[2]);
+        int brick = LOCAL_TO_BRICK(lx, ly, lz);
+        if (!chunk_brick_occupied(chunk, brick)) {
+            t = dda_skip(&dda, BRICK_SHIFT, &axis);
+            continue;
+        }
+        if ((chunk->brick_masks[brick] >> LOCAL_TO_BRICK_BIT(lx, ly, lz)) & 1) {
+            result.hit = true;
+            result.id = world_touch_chunk(world, chunk) ? chunk->blocks[CHUNK_INDEX(lx, ly, lz)] : BLOCK_AIR;
+            result.block[0] = dda.voxel[0];
+            result.block[1] = dda.voxel[1];
+            result.block[2] = dda.voxel[2];
+            result.face = axis < 0 ? FACE_NONE : (Face)(axis * 2 + (dda.step[axis] > 0));
+            result.distance = t;
+            return result;
+        }
+        t = dda_step(&dda, &axis);
+    }
+    return result;
+}
+
+// traces every ray in rays, out[i] is the result for rays[i]
+void raycast_batch(World* world, const Ray* rays, size_t count, RayHit* out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = raycast(world, (float*)rays[i].origin, (float*)rays[i].dir, rays[i].max_distance);
+    }
+}
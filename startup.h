@@ -0,0 +1,201 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "jobs.h"
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// when every startup phase began and ended, phases on different threads overlap
+typedef struct {
+    char name[32];
+    double start, end; // seconds since the profile started
+} StartupPhase;
+
+#define STARTUP_MAX_PHASES 48
+
+typedef struct {
+    double origin;
+    StartupPhase phases[STARTUP_MAX_PHASES];
+    atomic_int count;
+} StartupProfile;
+
+StartupProfile Startup;
+
+void startup_profile_start() {
+    Startup.origin = now_seconds();
+    atomic_store(&Startup.count, 0);
+}
+
+// records a phase that began at start (from now_seconds) and ends now, can be called from any thread
+void startup_phase(const char* name, double start) {
+    double end = now_seconds();
+    int index = atomic_fetch_add(&Startup.count, 1);
+    if (index >= STARTUP_MAX_PHASES) return;
+    StartupPhase* phase = &Startup.phases[index];
+    snprintf(phase->name, sizeof(phase->name), "%s", name);
+    phase->start = start - Startup.origin;
+    phase->end = end - Startup.origin;
+}
+
+int compare_phase_start(const void* a, const void* b) {
+    const StartupPhase* pa = a;
+    const StartupPhase* pb = b;
+    return (pa->start > pb->start) - (pa->start < pb->start);
+}
+
+// prints the phases in the order they began and how long it took to present the first frame
+void startup_report(FILE* out, double first_frame) {
+    int count = atomic_load(&Startup.count);
+    if (count > STARTUP_MAX_PHASES) count = STARTUP_MAX_PHASES;
+    qsort(Startup.phases, count, sizeof(StartupPhase), compare_phase_start);
+    fprintf(out, "%-24s %10s %10s %10s\n", "startup", "start ms", "end ms", "ms");
+    for (int i = 0; i < count; i++) {
+        StartupPhase* phase = &Startup.phases[i];
+        fprintf(out, "%-24s %10.2f %10.2f %10.2f\n", phase->name,
+            phase->start * 1000, phase->end * 1000, (phase->end - phase->start) * 1000);
+    }
+    fprintf(out, "%-24s %10s %10.2f\n", "first frame", "", (first_frame - Startup.origin) * 1000);
+}
+
+// startup work that doesn't touch gl runs as tasks on the job pool, a task is queued as soon as every task it
+// depends on has finished while the main thread creates the window and waits only for the tasks it needs
+// a task with a count runs that many items as separate jobs and finishes with the last one
+typedef bool (*TaskFunction)(void* arg, int item);
+
+#define MAX_TASKS 16
+#define MAX_TASK_DEPENDENTS 8
+
+typedef struct TaskGraph TaskGraph;
+
+typedef struct {
+    const char* name;
+    TaskFunction function;
+    void* arg;
+    int count;
+    int dependents[MAX_TASK_DEPENDENTS];
+    int dependent_count;
+    atomic_int waiting;   // dependencies not finished yet
+    atomic_int remaining; // items not finished yet
+    atomic_bool failed;   // an item or a dependency failed, dependents are skipped
+    atomic_bool done;
+    double start;
+} Task;
+
+// items are queued as jobs with the task's index packed next to the item's
+typedef struct {
+    TaskGraph* graph;
+    int task;
+    int item;
+} TaskItem;
+
+struct TaskGraph {
+    JobPool* pool;
+    Task tasks[MAX_TASKS];
+    int count;
+    TaskItem* items; // every item of every task, filled in by task_graph_start
+};
+
+// returns the task's index for dependents and task_wait
+int task_add(TaskGraph* graph, const char* name, TaskFunction function, void* arg, int count, const int* dependencies, int dependency_count) {
+    if (graph->count == MAX_TASKS) {
+        fprintf(stderr, "Failed to add startup task %s, raise MAX_TASKS\n", name);
+        abort();
+    }
+    int index = graph->count++;
+    Task* task = &graph->tasks[index];
+    *task = (Task){ .name = name, .function = function, .arg = arg, .count = count };
+    atomic_store(&task->waiting, dependency_count);
+    atomic_store(&task->remaining, count);
+    for (int i = 0; i < dependency_count; i++) {
+        Task* dependency = &graph->tasks[dependencies[i]];
+        if (dependency->dependent_count == MAX_TASK_DEPENDENTS) {
+            fprintf(stderr, "Failed to add startup task %s, raise MAX_TASK_DEPENDENTS\n", name);
+            abort();
+        }
+        dependency->dependents[dependency->dependent_count++] = index;
+    }
+    return index;
+}
+
+void task_release(TaskGraph* graph, int index);
+
+void task_finish(TaskGraph* graph, int index) {
+    Task* task = &graph->tasks[index];
+    if (!atomic_load(&task->failed)) startup_phase(task->name, task->start);
+    atomic_store(&task->done, true);
+    for (int i = 0; i < task->dependent_count; i++) {
+        Task* dependent = &graph->tasks[task->dependents[i]];
+        if (atomic_load(&task->failed)) atomic_store(&dependent->failed, true);
+        if (atomic_fetch_sub(&dependent->waiting, 1) == 1) task_release(graph, task->dependents[i]);
+    }
+}
+
+void task_item_job(void* arg) {
+    TaskItem* item = arg;
+    Task* task = &item->graph->tasks[item->task];
+    if (!atomic_load(&task->failed) && !task->function(task->arg, item->item)) atomic_store(&task->failed, true);
+    if (atomic_fetch_sub(&task->remaining, 1) == 1) task_finish(item->graph, item->task);
+}
+
+TaskItem* task_items(TaskGraph* graph, int index) {
+    TaskItem* items = graph->items;
+    for (int i = 0; i < index; i++) items += graph->tasks[i].count;
+    return items;
+}
+
+// queues every item of a task whose dependencies are done, failed tasks finish without running
+void task_release(TaskGraph* graph, int index) {
+    Task* task = &graph->tasks[index];
+    task->start = now_seconds();
+    if (task->count == 0 || atomic_load(&task->failed)) {
+        task_finish(graph, index);
+        return;
+    }
+    TaskItem* items = task_items(graph, index);
+    for (int i = 0; i < task->count; i++) job_submit(graph->pool, task_item_job, &items[i], NULL);
+}
+
+bool task_graph_start(TaskGraph* graph, JobPool* pool) {
+    graph->pool = pool;
+    size_t total = 0;
+    for (int i = 0; i < graph->count; i++) total += graph->tasks[i].count;
+    graph->items = mem_malloc(MEM_JOBS, sizeof(TaskItem) * (total ? total : 1));
+    if (!graph->items) return false;
+    for (int i = 0; i < graph->count; i++) {
+        TaskItem* items = task_items(graph, i);
+        for (int j = 0; j < graph->tasks[i].count; j++) items[j] = (TaskItem){ graph, i, j };
+    }
+    // counted before releasing anything so a task finishing early can't release a root twice
+    bool roots[MAX_TASKS];
+    for (int i = 0; i < graph->count; i++) roots[i] = atomic_load(&graph->tasks[i].waiting) == 0;
+    for (int i = 0; i < graph->count; i++) {
+        if (roots[i]) task_release(graph, i);
+    }
+    return true;
+}
+
+// blocks until the task has finished, false if it or one of its dependencies failed
+bool task_wait(TaskGraph* graph, int index) {
+    Task* task = &graph->tasks[index];
+    JobPool* pool = graph->pool;
+    pthread_mutex_lock(&pool->lock);
+    while (!atomic_load(&task->done)) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    return !atomic_load(&task->failed);
+}
+
+// every task has to be finished
+void free_task_graph(TaskGraph* graph) {
+    size_t total = 0;
+    for (int i = 0; i < graph->count; i++) total += graph->tasks[i].count;
+    mem_free(MEM_JOBS, graph->items, sizeof(TaskItem) * (total ? total : 1));
+    graph->items = NULL;
+}
@@ -0,0 +1,468 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "blocks.h"
+#include "memory_stats.h"
+#include "arena.h"
+#include "pool.h"
+#include "compress.h"
+
+// opaque blocks stop light
+bool block_opaque(BlockId id) {
+    return Blocks.opaque[id];
+}
+
+// whether the face of id toward neighbor is covered, glass next to glass or water next to water has no face between
+bool block_face_hidden(BlockId id, BlockId neighbor) {
+    return Blocks.opaque[neighbor] || (neighbor == id && !Blocks.opaque[id]);
+}
+
+// face order matches createBlock, axis * 2 + (negative side)
+typedef enum {
+    FACE_POS_X,
+    FACE_NEG_X,
+    FACE_POS_Y,
+    FACE_NEG_Y,
+    FACE_POS_Z,
+    FACE_NEG_Z,
+    FACE_NONE,
+} Face;
+
+const int FACE_NORMALS[6][3] = {
+    { 1, 0, 0 }, { -1, 0, 0 },
+    { 0, 1, 0 }, { 0, -1, 0 },
+    { 0, 0, 1 }, { 0, 0, -1 },
+};
+
+#define CHUNK_SHIFT 5
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+#define CHUNK_MASK (CHUNK_SIZE - 1)
+#define CHUNK_VOLUME (CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+
+// occupancy summary, a chunk is split into 4x4x4 bricks and a brick fits in one 64 bit mask
+#define BRICK_SHIFT 2
+#define BRICK_SIZE (1 << BRICK_SHIFT)
+#define CHUNK_BRICKS_SHIFT (CHUNK_SHIFT - BRICK_SHIFT)
+#define CHUNK_BRICKS (1 << CHUNK_BRICKS_SHIFT)
+#define CHUNK_BRICK_COUNT (CHUNK_BRICKS * CHUNK_BRICKS * CHUNK_BRICKS)
+#define BRICK_FULL UINT64_MAX
+
+// light of a block, sky light in the high nibble and block light in the low one
+#define LIGHT_MAX 15
+#define LIGHT_SKY(light) ((light) >> 4)
+#define LIGHT_BLOCK(light) ((light) & 0xf)
+// missing chunks are open sky
+#define LIGHT_EMPTY_CHUNK (LIGHT_MAX << 4)
+
+// the world is a fixed box of chunks around the origin, in chunk coordinates
+#define WORLD_CHUNKS_XZ 16
+#define WORLD_CHUNKS_Y 4
+#define WORLD_MIN_XZ (-WORLD_CHUNKS_XZ / 2)
+#define WORLD_MIN_Y (-WORLD_CHUNKS_Y / 2)
+#define WORLD_CHUNK_COUNT (WORLD_CHUNKS_Y * WORLD_CHUNKS_XZ * WORLD_CHUNKS_XZ)
+
+// voxel storage of a chunk, the part that's compressed while the chunk is cold
+typedef struct {
+    BlockId blocks[CHUNK_VOLUME];
+    uint8_t light[CHUNK_VOLUME]; // written by light.h
+} ChunkVoxels;
+
+typedef struct {
+    int cx, cy, cz;
+    int solid_count; // non air blocks, 0 means the chunk can be skipped entirely
+    bool dirty;      // queued for remeshing
+    // point into the chunk's ChunkVoxels, NULL while it's compressed
+    // only valid after world_get_chunk or world_touch_chunk, which unpack it
+    BlockId* blocks;
+    uint8_t* light;
+    uint8_t* packed; // pack_bytes of blocks then light while compressed
+    size_t packed_size;
+    // World.tick of the last access, touched from every thread that reads the world, relaxed since only
+    // world_compress_cold acts on it and it runs with the other threads shut out
+    _Atomic uint32_t last_used;
+    // kept in sync by world_set_block, bit set for every non air block / every opaque block / every non empty brick
+    uint64_t brick_masks[CHUNK_BRICK_COUNT];
+    uint64_t brick_opaque[CHUNK_BRICK_COUNT];
+    uint64_t brick_occupancy[CHUNK_BRICK_COUNT / 64];
+    // bit b of visibility[a] is set when faces a and b are connected through non opaque blocks inside the chunk
+    // refreshed by chunk_update_visibility whenever the chunk is remeshed
+    uint8_t visibility[6];
+} Chunk;
+
+typedef struct {
+    Chunk* chunks[WORLD_CHUNKS_Y][WORLD_CHUNKS_XZ][WORLD_CHUNKS_XZ]; // NULL chunks are all air
+    // chunks whose mesh is out of date, each chunk is in here at most once
+    Chunk* dirty[WORLD_CHUNK_COUNT];
+    size_t dirty_count;
+    Pool chunk_pool; // storage of every chunk above
+    Pool voxel_pool; // ChunkVoxels of the chunks that aren't compressed
+    // held while a chunk is packed or unpacked, chunks can be unpacked from any thread reading the world
+    pthread_mutex_t voxel_lock;
+    uint32_t tick;     // advanced by world_compress_cold
+    size_t hot_count;  // chunks with unpacked voxels
+    size_t packed_bytes;
+} World;
+
+// chunks per slab of the chunk and voxel pools, a voxel slab is a quarter megabyte
+#define CHUNK_POOL_SLAB 16
+#define VOXEL_POOL_SLAB 4
+// chunks kept unpacked by world_compress_cold, 8 MB of voxels
+#define WORLD_HOT_CHUNKS 128
+// packing takes about 0.1 ms a chunk, the rest waits for the next tick so a frame never stalls on it
+#define WORLD_COMPRESS_PER_TICK 8
+
+// local block coordinates, 0..CHUNK_SIZE-1
+#define CHUNK_INDEX(x, y, z) ((((y) << CHUNK_SHIFT) + (z)) << CHUNK_SHIFT | (x))
+
+// block coordinates are integers, block (x, y, z) covers [x - 0.5, x + 0.5] on every axis
+// >> on negative ints floors with gcc, clang and cl
+#define BLOCK_TO_CHUNK(v) ((v) >> CHUNK_SHIFT)
+#define BLOCK_TO_LOCAL(v) ((v) & CHUNK_MASK)
+
+// brick coordinates, 0..CHUNK_BRICKS-1
+#define BRICK_INDEX(bx, by, bz) ((((by) << CHUNK_BRICKS_SHIFT) + (bz)) << CHUNK_BRICKS_SHIFT | (bx))
+// brick of a local block coordinate and the bit of that block in the brick mask
+#define LOCAL_TO_BRICK(x, y, z) BRICK_INDEX((x) >> BRICK_SHIFT, (y) >> BRICK_SHIFT, (z) >> BRICK_SHIFT)
+#define LOCAL_TO_BRICK_BIT(x, y, z) (((((y) & (BRICK_SIZE - 1)) << BRICK_SHIFT | ((z) & (BRICK_SIZE - 1))) << BRICK_SHIFT) | ((x) & (BRICK_SIZE - 1)))
+
+bool chunk_brick_occupied(const Chunk* chunk, int brick) {
+    return (chunk->brick_occupancy[brick >> 6] >> (brick & 63)) & 1;
+}
+
+#define ALL_FACES 0x3f
+
+// flood fills the non opaque blocks of the chunk and links every pair of faces a connected region of them touches
+void chunk_update_visibility(Chunk* chunk) {
+    memset(chunk->visibility, 0, sizeof(chunk->visibility));
+    if (chunk->solid_count == 0) {
+        memset(chunk->visibility, ALL_FACES, sizeof(chunk->visibility));
+        return;
+    }
+    Arena* arena = scratch_arena();
+    size_t mark = arena->used;
+    uint64_t* visited = arena_alloc(arena, sizeof(uint64_t) * (CHUNK_VOLUME / 64));
+    uint16_t* stack = arena_alloc(arena, sizeof(uint16_t) * CHUNK_VOLUME); // every cell is pushed at most once
+    memset(visited, 0, sizeof(uint64_t) * (CHUNK_VOLUME / 64));
+    for (int start = 0; start < CHUNK_VOLUME; start++) {
+        if (block_opaque(chunk->blocks[start]) || (visited[start >> 6] >> (start & 63)) & 1) continue;
+        visited[start >> 6] |= (uint64_t)1 << (start & 63);
+        size_t top = 0;
+        stack[top++] = start;
+        uint8_t faces = 0;
+        while (top) {
+            int index = stack[--top];
+            int p[3] = { index & CHUNK_MASK, index >> (2 * CHUNK_SHIFT), (index >> CHUNK_SHIFT) & CHUNK_MASK };
+            for (int face = 0; face < 6; face++) {
+                int n[3] = { p[0] + FACE_NORMALS[face][0], p[1] + FACE_NORMALS[face][1], p[2] + FACE_NORMALS[face][2] };
+                if ((unsigned)n[0] >= CHUNK_SIZE || (unsigned)n[1] >= CHUNK_SIZE || (unsigned)n[2] >= CHUNK_SIZE) {
+                    faces |= 1 << face;
+                    continue;
+                }
+                int next = CHUNK_INDEX(n[0], n[1], n[2]);
+                if (block_opaque(chunk->blocks[next]) || (visited[next >> 6] >> (next & 63)) & 1) continue;
+                visited[next >> 6] |= (uint64_t)1 << (next & 63);
+                stack[top++] = next;
+            }
+        }
+        for (int face = 0; face < 6; face++) {
+            if (faces & (1 << face)) chunk->visibility[face] |= faces;
+        }
+    }
+    arena_rewind(arena, mark);
+}
+
+bool world_chunk_in_bounds(int cx, int cy, int cz) {
+    return cx >= WORLD_MIN_XZ && cx < WORLD_MIN_XZ + WORLD_CHUNKS_XZ
+        && cy >= WORLD_MIN_Y && cy < WORLD_MIN_Y + WORLD_CHUNKS_Y
+        && cz >= WORLD_MIN_XZ && cz < WORLD_MIN_XZ + WORLD_CHUNKS_XZ;
+}
+
+ChunkVoxels* world_alloc_voxels(World* world) {
+    pthread_mutex_lock(&world->voxel_lock);
+    ChunkVoxels* voxels = pool_alloc(&world->voxel_pool);
+    if (voxels) world->hot_count++;
+    pthread_mutex_unlock(&world->voxel_lock);
+    return voxels;
+}
+
+// packs the voxels of a chunk and gives its ChunkVoxels back to the pool
+// callers make sure no other thread is reading the chunk, see world_compress_cold
+bool chunk_compress(World* world, Chunk* chunk) {
+    if (!chunk->blocks) return true;
+    Arena* arena = scratch_arena();
+    size_t mark = arena->used;
+    uint8_t* staging = arena_alloc(arena, 2 * PACKED_MAX_BYTES(CHUNK_VOLUME));
+    // BlockId is a byte so blocks pack like light
+    size_t size = pack_bytes(chunk->blocks, CHUNK_VOLUME, staging);
+    size += pack_bytes(chunk->light, CHUNK_VOLUME, staging + size);
+    uint8_t* packed = mem_malloc(MEM_VOXELS, size);
+    if (packed) memcpy(packed, staging, size);
+    arena_rewind(arena, mark);
+    if (!packed) return false;
+
+    pthread_mutex_lock(&world->voxel_lock);
+    pool_free(&world->voxel_pool, (ChunkVoxels*)chunk->blocks);
+    chunk->blocks = NULL;
+    chunk->light = NULL;
+    chunk->packed = packed;
+    chunk->packed_size = size;
+    world->hot_count--;
+    world->packed_bytes += size;
+    pthread_mutex_unlock(&world->voxel_lock);
+    return true;
+}
+
+bool chunk_decompress(World* world, Chunk* chunk) {
+    pthread_mutex_lock(&world->voxel_lock);
+    // another thread may have unpacked it while this one waited
+    if (chunk->blocks) {
+        pthread_mutex_unlock(&world->voxel_lock);
+        return true;
+    }
+    ChunkVoxels* voxels = pool_alloc(&world->voxel_pool);
+    if (!voxels) {
+        pthread_mutex_unlock(&world->voxel_lock);
+        return false;
+    }
+    size_t used = unpack_bytes(chunk->packed, CHUNK_VOLUME, voxels->blocks);
+    unpack_bytes(chunk->packed + used, CHUNK_VOLUME, voxels->light);
+    mem_free(MEM_VOXELS, chunk->packed, chunk->packed_size);
+    world->hot_count++;
+    world->packed_bytes -= chunk->packed_size;
+    chunk->packed = NULL;
+    chunk->packed_size = 0;
+    chunk->light = voxels->light;
+    // readers check blocks without the lock, it's published last
+    atomic_thread_fence(memory_order_release);
+    chunk->blocks = voxels->blocks;
+    pthread_mutex_unlock(&world->voxel_lock);
+    return true;
+}
+
+// marks a chunk as used and unpacks it if it's compressed, false if it couldn't be unpacked
+bool world_touch_chunk(World* world, Chunk* chunk) {
+    atomic_store_explicit(&chunk->last_used, world->tick, memory_order_relaxed);
+    return chunk->blocks || chunk_decompress(world, chunk);
+}
+
+// chunk without unpacking it, only its cx, cy, cz, solid_count, dirty, brick and visibility fields can be read
+Chunk* world_peek_chunk(World* world, int cx, int cy, int cz) {
+    if (!world_chunk_in_bounds(cx, cy, cz)) return NULL;
+    return world->chunks[cy - WORLD_MIN_Y][cz - WORLD_MIN_XZ][cx - WORLD_MIN_XZ];
+}
+
+Chunk* world_get_chunk(World* world, int cx, int cy, int cz) {
+    Chunk* chunk = world_peek_chunk(world, cx, cy, cz);
+    if (!chunk || !world_touch_chunk(world, chunk)) return NULL;
+    return chunk;
+}
+
+BlockId world_get_block(World* world, int x, int y, int z) {
+    Chunk* chunk = world_get_chunk(world, BLOCK_TO_CHUNK(x), BLOCK_TO_CHUNK(y), BLOCK_TO_CHUNK(z));
+    if (!chunk) return BLOCK_AIR;
+    return chunk->blocks[CHUNK_INDEX(BLOCK_TO_LOCAL(x), BLOCK_TO_LOCAL(y), BLOCK_TO_LOCAL(z))];
+}
+
+uint8_t world_get_light(World* world, int x, int y, int z) {
+    Chunk* chunk = world_get_chunk(world, BLOCK_TO_CHUNK(x), BLOCK_TO_CHUNK(y), BLOCK_TO_CHUNK(z));
+    if (!chunk) return LIGHT_EMPTY_CHUNK;
+    return chunk->light[CHUNK_INDEX(BLOCK_TO_LOCAL(x), BLOCK_TO_LOCAL(y), BLOCK_TO_LOCAL(z))];
+}
+
+// returns false if the block is outside the world
+bool world_set_block(World* world, int x, int y, int z, BlockId id) {
+    int cx = BLOCK_TO_CHUNK(x), cy = BLOCK_TO_CHUNK(y), cz = BLOCK_TO_CHUNK(z);
+    if (!world_chunk_in_bounds(cx, cy, cz)) return false;
+    Chunk** slot = &world->chunks[cy - WORLD_MIN_Y][cz - WORLD_MIN_XZ][cx - WORLD_MIN_XZ];
+    if (!*slot) {
+        if (id == BLOCK_AIR) return true;
+        Chunk* chunk = pool_alloc(&world->chunk_pool);
+        if (!chunk) return false;
+        ChunkVoxels* voxels = world_alloc_voxels(world);
+        if (!voxels) {
+            pool_free(&world->chunk_pool, chunk);
+            return false;
+        }
+        chunk->cx = cx;
+        chunk->cy = cy;
+        chunk->cz = cz;
+        chunk->blocks = voxels->blocks;
+        chunk->light = voxels->light;
+        atomic_store_explicit(&chunk->last_used, world->tick, memory_order_relaxed);
+        memset(chunk->light, LIGHT_EMPTY_CHUNK, sizeof(voxels->light));
+        *slot = chunk;
+    } else if (!world_touch_chunk(world, *slot)) {
+        return false;
+    }
+    Chunk* chunk = *slot;
+    BlockId* block = &chunk->blocks[CHUNK_INDEX(BLOCK_TO_LOCAL(x), BLOCK_TO_LOCAL(y), BLOCK_TO_LOCAL(z))];
+    chunk->solid_count += (id != BLOCK_AIR) - (*block != BLOCK_AIR);
+    *block = id;
+
+    int lx = BLOCK_TO_LOCAL(x), ly = BLOCK_TO_LOCAL(y), lz = BLOCK_TO_LOCAL(z);
+    int brick = LOCAL_TO_BRICK(lx, ly, lz);
+    uint64_t bit = (uint64_t)1 << LOCAL_TO_BRICK_BIT(lx, ly, lz);
+    if (id != BLOCK_AIR) {
+        chunk->brick_masks[brick] |= bit;
+    } else {
+        chunk->brick_masks[brick] &= ~bit;
+    }
+    if (block_opaque(id)) {
+        chunk->brick_opaque[brick] |= bit;
+    } else {
+        chunk->brick_opaque[brick] &= ~bit;
+    }
+    uint64_t brick_bit = (uint64_t)1 << (brick & 63);
+    if (chunk->brick_masks[brick]) {
+        chunk->brick_occupancy[brick >> 6] |= brick_bit;
+    } else {
+        chunk->brick_occupancy[brick >> 6] &= ~brick_bit;
+    }
+    return true;
+}
+
+void world_mark_dirty(World* world, Chunk* chunk) {
+    if (!chunk || chunk->dirty) return;
+    chunk->dirty = true;
+    world->dirty[world->dirty_count++] = chunk;
+}
+
+void world_mark_all_dirty(World* world) {
+    for (int y = 0; y < WORLD_CHUNKS_Y; y++) {
+        for (int z = 0; z < WORLD_CHUNKS_XZ; z++) {
+            for (int x = 0; x < WORLD_CHUNKS_XZ; x++) {
+                world_mark_dirty(world, world->chunks[y][z][x]);
+            }
+        }
+    }
+}
+
+// next chunk to remesh, NULL once everything is up to date
+Chunk* world_pop_dirty(World* world) {
+    if (world->dirty_count == 0) return NULL;
+    Chunk* chunk = world->dirty[--world->dirty_count];
+    chunk->dirty = false;
+    return chunk;
+}
+
+// chunk offsets, -1 to 1 on each axis, of the chunks whose meshes read the block at world coordinate x, y, z
+// meshing reads a block's whole 3x3x3 neighborhood for ao, so a block on an edge or corner of its chunk is seen by
+// up to 7 chunks besides its own
+void block_chunk_span(int x, int y, int z, int min[3], int max[3]) {
+    int local[3] = { BLOCK_TO_LOCAL(x), BLOCK_TO_LOCAL(y), BLOCK_TO_LOCAL(z) };
+    for (int a = 0; a < 3; a++) {
+        min[a] = local[a] == 0 ? -1 : 0;
+        max[a] = local[a] == CHUNK_MASK ? 1 : 0;
+    }
+}
+
+// world_set_block for gameplay edits, queues the chunk and every neighbor whose mesh reads the block
+bool world_edit_block(World* world, int x, int y, int z, BlockId id) {
+    if (!world_set_block(world, x, y, z, id)) return false;
+    int cx = BLOCK_TO_CHUNK(x), cy = BLOCK_TO_CHUNK(y), cz = BLOCK_TO_CHUNK(z);
+    int min[3], max[3];
+    block_chunk_span(x, y, z, min, max);
+    for (int dy = min[1]; dy <= max[1]; dy++) {
+        for (int dz = min[2]; dz <= max[2]; dz++) {
+            for (int dx = min[0]; dx <= max[0]; dx++) {
+                world_mark_dirty(world, world_get_chunk(world, cx + dx, cy + dy, cz + dz));
+            }
+        }
+    }
+    return true;
+}
+
+// highest block world_height_at can return
+#define WORLD_MAX_HEIGHT 10
+
+int world_height_at(int x, int z) {
+    return (int)(4.0f * sinf(x * 0.05f) + 4.0f * cosf(z * 0.07f) + 2.0f * sinf((x + z) * 0.13f));
+}
+
+// rolling hills, grass on top of three dirt on top of stone down to the bottom of the world
+void world_generate(World* world) {
+    int min_xz = WORLD_MIN_XZ * CHUNK_SIZE;
+    int max_xz = (WORLD_MIN_XZ + WORLD_CHUNKS_XZ) * CHUNK_SIZE;
+    int min_y = WORLD_MIN_Y * CHUNK_SIZE;
+    // every chunk from the bottom of the world up to the highest hill ends up allocated
+    int layers = BLOCK_TO_CHUNK(WORLD_MAX_HEIGHT) - WORLD_MIN_Y + 1;
+    if (layers > WORLD_CHUNKS_Y) layers = WORLD_CHUNKS_Y;
+    pool_reserve(&world->chunk_pool, (size_t)layers * WORLD_CHUNKS_XZ * WORLD_CHUNKS_XZ);
+    pool_reserve(&world->voxel_pool, (size_t)layers * WORLD_CHUNKS_XZ * WORLD_CHUNKS_XZ);
+    for (int z = min_xz; z < max_xz; z++) {
+        for (int x = min_xz; x < max_xz; x++) {
+            int height = world_height_at(x, z);
+            for (int y = min_y; y <= height; y++) {
+                BlockId id = y == height ? BLOCK_GRASS : y > height - 4 ? BLOCK_DIRT : BLOCK_COBBLED_STONE;
+                world_set_block(world, x, y, z, id);
+            }
+        }
+    }
+}
+
+int compare_last_used(const void* a, const void* b) {
+    uint32_t ta = atomic_load_explicit(&(*(Chunk* const*)a)->last_used, memory_order_relaxed);
+    uint32_t tb = atomic_load_explicit(&(*(Chunk* const*)b)->last_used, memory_order_relaxed);
+    return (ta > tb) - (ta < tb);
+}
+
+// packs the least recently used chunks until at most hot_budget are unpacked, up to WORLD_COMPRESS_PER_TICK
+// of them, and starts a new tick
+// chunks used this tick or waiting to be remeshed stay unpacked
+// no other thread may read the world meanwhile, the light thread's world_lock has to be held
+void world_compress_cold(World* world, size_t hot_budget) {
+    if (world->hot_count > hot_budget) {
+        Arena* arena = scratch_arena();
+        size_t mark = arena->used;
+        Chunk** candidates = arena_alloc(arena, sizeof(Chunk*) * WORLD_CHUNK_COUNT);
+        size_t count = 0;
+        for (int y = 0; y < WORLD_CHUNKS_Y; y++) {
+            for (int z = 0; z < WORLD_CHUNKS_XZ; z++) {
+                for (int x = 0; x < WORLD_CHUNKS_XZ; x++) {
+                    Chunk* chunk = world->chunks[y][z][x];
+                    if (chunk && chunk->blocks && !chunk->dirty && atomic_load_explicit(&chunk->last_used, memory_order_relaxed) != world->tick) {
+                        candidates[count++] = chunk;
+                    }
+                }
+            }
+        }
+        qsort(candidates, count, sizeof(Chunk*), compare_last_used);
+        for (size_t i = 0; i < count && i < WORLD_COMPRESS_PER_TICK && world->hot_count > hot_budget; i++) {
+            if (!chunk_compress(world, candidates[i])) break;
+        }
+        arena_rewind(arena, mark);
+        pthread_mutex_lock(&world->voxel_lock);
+        pool_trim(&world->voxel_pool, hot_budget);
+        pthread_mutex_unlock(&world->voxel_lock);
+    }
+    world->tick++;
+}
+
+World* new_World() {
+    World* world = mem_calloc(MEM_VOXELS, 1, sizeof(World));
+    if (!world) return NULL;
+    world->chunk_pool = new_Pool(sizeof(Chunk), CHUNK_POOL_SLAB, MEM_VOXELS);
+    world->voxel_pool = new_Pool(sizeof(ChunkVoxels), VOXEL_POOL_SLAB, MEM_VOXELS);
+    pthread_mutex_init(&world->voxel_lock, NULL);
+    return world;
+}
+
+void free_World(World* world) {
+    for (int y = 0; y < WORLD_CHUNKS_Y; y++) {
+        for (int z = 0; z < WORLD_CHUNKS_XZ; z++) {
+            for (int x = 0; x < WORLD_CHUNKS_XZ; x++) {
+                Chunk* chunk = world->chunks[y][z][x];
+                if (chunk) mem_free(MEM_VOXELS, chunk->packed, chunk->packed_size);
+            }
+        }
+    }
+    free_Pool(&world->voxel_pool);
+    free_Pool(&world->chunk_pool);
+    pthread_mutex_destroy(&world->voxel_lock);
+    mem_free(MEM_VOXELS, world, sizeof(World));
+}